@@ -23,7 +23,35 @@ static int64_t ticks;
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
-static struct list sleeping_threads;
+
+/* One-shot timer events, kept in a hierarchical timing wheel.
+
+   The first level has one list per tick for the next WHEEL1_SIZE
+   ticks.  Each further level covers WHEELN_SIZE times the span
+   of the one below, one list per slot of that span.  Every
+   WHEEL1_SIZE ticks the events in the next slot of the second
+   level are "cascaded", that is, redistributed into the first
+   level, and so on up the levels.  Arming and cancelling an
+   event are thus constant time, and each tick only has to look
+   at the first-level list for that tick.
+
+   WHEEL_TICKS is the next tick whose first-level list has not
+   been run yet.  An event is fired once the tick it was armed
+   for is <= the current tick, even if it was armed for a tick
+   that had already passed. */
+#define WHEEL1_BITS 8
+#define WHEELN_BITS 6
+#define WHEEL1_SIZE (1 << WHEEL1_BITS)
+#define WHEELN_SIZE (1 << WHEELN_BITS)
+#define WHEELN_CNT 4
+static struct list wheel1[WHEEL1_SIZE];
+static struct list wheeln[WHEELN_CNT][WHEELN_SIZE];
+static int64_t wheel_ticks;
+
+/* Cost of the timer interrupt handler, in CPU cycles. */
+static uint64_t intr_cycles;    /* Total since last reset. */
+static uint64_t intr_max_cycles; /* Worst case since last reset. */
+static int64_t intr_cnt;        /* # of interrupts since last reset. */
 
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
@@ -31,17 +59,26 @@ static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
 
-bool earlier_wake_time (const struct list_elem *e1, const struct list_elem *e2, void *aux UNUSED);
-void wake_threads (void);
+static void wheel_insert (struct timer_event *);
+static int wheel_cascade (int level);
+static void wheel_run (void);
+static void wake_sleeper (void *thread);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  int i, j;
+
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
-  list_init (&sleeping_threads);
+
+  for (i = 0; i < WHEEL1_SIZE; i++)
+    list_init (&wheel1[i]);
+  for (i = 0; i < WHEELN_CNT; i++)
+    for (j = 0; j < WHEELN_SIZE; j++)
+      list_init (&wheeln[i][j]);
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -98,18 +135,76 @@ timer_sleep (int64_t ticks)
   
   if (ticks <= 0) 
     return;
-  enum intr_level old_level = intr_disable ();  
-  int64_t start = timer_ticks ();
+  struct timer_event wakeup;
+  timer_event_init (&wakeup, wake_sleeper, thread_current ());
 
-  struct thread *current = thread_current ();
-  current->wake_time = start + ticks;
-  list_insert_ordered (&sleeping_threads, &current->elem, (list_less_func *) &earlier_wake_time, NULL); 
-  
+  enum intr_level old_level = intr_disable ();  
+  timer_event_arm (&wakeup, timer_ticks () + ticks);
   thread_block ();
-  
   intr_set_level (old_level);
 }
 
+/* Initializes EVENT as a one-shot timer that calls FUNC, passing
+   AUX, when it fires.  The event starts out disarmed. */
+void
+timer_event_init (struct timer_event *event, timer_func *func, void *aux)
+{
+  ASSERT (event != NULL);
+  ASSERT (func != NULL);
+
+  event->func = func;
+  event->aux = aux;
+  event->armed = false;
+}
+
+/* Arms EVENT to fire at the timer interrupt for tick WHEN, as
+   returned by timer_ticks(), or at the next timer interrupt if
+   WHEN has already passed.  If EVENT was already armed, it is
+   moved to WHEN.
+
+   EVENT's function runs in the timer interrupt handler, with
+   interrupts off, so it must not sleep.  It may re-arm EVENT.
+   EVENT must stay in place until it has fired or been
+   cancelled. */
+void
+timer_event_arm (struct timer_event *event, int64_t when)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (event->armed)
+    list_remove (&event->elem);
+  event->when = when;
+  event->armed = true;
+  wheel_insert (event);
+
+  intr_set_level (old_level);
+}
+
+/* Disarms EVENT.  Returns true if it was armed, false if it had
+   already fired or was never armed. */
+bool
+timer_event_cancel (struct timer_event *event)
+{
+  enum intr_level old_level = intr_disable ();
+  bool was_armed = event->armed;
+
+  if (was_armed)
+    {
+      list_remove (&event->elem);
+      event->armed = false;
+    }
+
+  intr_set_level (old_level);
+  return was_armed;
+}
+
+/* Returns true if EVENT is armed and has not yet fired. */
+bool
+timer_event_armed (const struct timer_event *event)
+{
+  return event->armed;
+}
+
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
    turned on. */
 void
@@ -179,14 +274,56 @@ timer_print_stats (void)
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
+
+/* Starts a new measurement of the timer interrupt handler's
+   cost. */
+void
+timer_reset_intr_stats (void)
+{
+  enum intr_level old_level = intr_disable ();
+  intr_cycles = intr_max_cycles = 0;
+  intr_cnt = 0;
+  intr_set_level (old_level);
+}
+
+/* Stores the average and worst-case number of CPU cycles the
+   timer interrupt handler took since the last call to
+   timer_reset_intr_stats() into *AVG and *MAX. */
+void
+timer_get_intr_stats (uint64_t *avg, uint64_t *max)
+{
+  enum intr_level old_level = intr_disable ();
+  *avg = intr_cnt > 0 ? intr_cycles / intr_cnt : 0;
+  *max = intr_max_cycles;
+  intr_set_level (old_level);
+}
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  uint64_t start = timer_read_tsc ();
+  uint64_t cycles;
+
   ticks++;
   thread_tick ();
-  wake_threads ();
+  wheel_run ();
+
+  cycles = timer_read_tsc () - start;
+  intr_cycles += cycles;
+  if (cycles > intr_max_cycles)
+    intr_max_cycles = cycles;
+  intr_cnt++;
+}
+
+/* Returns the CPU's time-stamp counter, which counts clock
+   cycles.  Useful for timing things much shorter than a tick. */
+uint64_t
+timer_read_tsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
 }
 
 
@@ -261,23 +398,107 @@ real_time_delay (int64_t num, int32_t denom)
   busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
 
-bool earlier_wake_time (const struct list_elem *e1, const struct list_elem *e2, void *aux UNUSED) {
-  struct thread *t1 = list_entry (e1, struct thread, elem);
-  struct thread *t2 = list_entry (e2, struct thread, elem);
-  return t1->wake_time < t2->wake_time;
+/* Adds EVENT to the list in the timing wheel for EVENT->when. */
+static void
+wheel_insert (struct timer_event *event)
+{
+  int64_t when = event->when;
+  int64_t delta = when - wheel_ticks;
+  struct list *slot;
+  int level;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (delta < 0)
+    {
+      /* Already due: fire at the next tick that is run. */
+      slot = &wheel1[wheel_ticks & (WHEEL1_SIZE - 1)];
+    }
+  else if (delta < WHEEL1_SIZE)
+    slot = &wheel1[when & (WHEEL1_SIZE - 1)];
+  else
+    {
+      /* Find the first level whose span covers DELTA.  Events
+         beyond the span of the last level go in its farthest
+         slot and are cascaded back down as often as needed. */
+      for (level = 0; level < WHEELN_CNT - 1; level++)
+        if (delta < (int64_t) 1 << (WHEEL1_BITS + (level + 1) * WHEELN_BITS))
+          break;
+      if (delta >= (int64_t) 1 << (WHEEL1_BITS + WHEELN_CNT * WHEELN_BITS))
+        when = wheel_ticks
+               + ((int64_t) 1 << (WHEEL1_BITS + WHEELN_CNT * WHEELN_BITS)) - 1;
+      slot = &wheeln[level][(when >> (WHEEL1_BITS + level * WHEELN_BITS))
+                            & (WHEELN_SIZE - 1)];
+    }
+  list_push_back (slot, &event->elem);
 }
 
-void wake_threads () {
-  struct list_elem *e;
-  struct thread *t;
-  bool check_threads = false;
-  for (e = list_begin (&sleeping_threads); 
-      e != list_end (&sleeping_threads) && (t = list_entry (e, struct thread, elem))->wake_time == timer_ticks (); 
-      e = list_begin (&sleeping_threads)) {
-    list_remove (e);
-    thread_unblock(t);
-    check_threads = true;
-  }
-  if (check_threads)
+/* Moves the events in the current slot of LEVEL of the timing
+   wheel back into the wheel, which places them in lower levels.
+   Returns the index of the slot. */
+static int
+wheel_cascade (int level)
+{
+  int index = (wheel_ticks >> (WHEEL1_BITS + level * WHEELN_BITS))
+              & (WHEELN_SIZE - 1);
+  struct list *slot = &wheeln[level][index];
+  struct list events;
+
+  list_init (&events);
+  while (!list_empty (slot))
+    list_push_back (&events, list_pop_front (slot));
+  while (!list_empty (&events))
+    wheel_insert (list_entry (list_pop_front (&events),
+                              struct timer_event, elem));
+  return index;
+}
+
+/* Fires every armed event that is due as of the current tick.
+   Called from the timer interrupt. */
+static void
+wheel_run (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (wheel_ticks <= ticks)
+    {
+      int index = wheel_ticks & (WHEEL1_SIZE - 1);
+      struct list due;
+      int level;
+
+      /* Each time the first level wraps around, refill it from
+         the level above, and so on up. */
+      if (index == 0)
+        for (level = 0; level < WHEELN_CNT; level++)
+          if (wheel_cascade (level) != 0)
+            break;
+
+      /* Take the due events off the wheel before firing any, so
+         that an event re-armed by its own function is not fired
+         again until a later tick. */
+      list_init (&due);
+      while (!list_empty (&wheel1[index]))
+        list_push_back (&due, list_pop_front (&wheel1[index]));
+      wheel_ticks++;
+
+      while (!list_empty (&due))
+        {
+          struct timer_event *event
+            = list_entry (list_pop_front (&due), struct timer_event, elem);
+          event->armed = false;
+          event->func (event->aux);
+        }
+    }
+}
+
+/* Timer function for timer_sleep(): wakes up thread T, and
+   preempts the running thread if T has higher priority. */
+static void
+wake_sleeper (void *t_)
+{
+  struct thread *t = t_;
+
+  thread_unblock (t);
+  if (t->priority > thread_current ()->priority)
     intr_yield_on_return ();
 }
@@ -1,7 +1,9 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -19,11 +21,32 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+/* One-shot timers. */
+typedef void timer_func (void *aux);
+struct timer_event
+  {
+    struct list_elem elem;      /* Element in a timing wheel list. */
+    int64_t when;               /* Tick at which to fire. */
+    timer_func *func;           /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool armed;                 /* True while in the timing wheel. */
+  };
+
+void timer_event_init (struct timer_event *, timer_func *, void *aux);
+void timer_event_arm (struct timer_event *, int64_t when);
+bool timer_event_cancel (struct timer_event *);
+bool timer_event_armed (const struct timer_event *);
+
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* Cycle counting. */
+uint64_t timer_read_tsc (void);
+
 void timer_print_stats (void);
+void timer_reset_intr_stats (void);
+void timer_get_intr_stats (uint64_t *avg, uint64_t *max);
 
 #endif /* devices/timer.h */
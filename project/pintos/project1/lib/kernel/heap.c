@@ -0,0 +1,186 @@
+/* Priority queue.
+
+   See heap.h for basic information. */
+
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *link (struct heap *, struct heap_elem *,
+                               struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void cut (struct heap_elem *);
+
+/* Initializes heap H to order its elements using LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  h->elem_cnt = 0;
+  h->root = NULL;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts NEW into heap H. */
+void
+heap_push (struct heap *h, struct heap_elem *new)
+{
+  ASSERT (h != NULL);
+  ASSERT (new != NULL);
+
+  new->child = new->next = new->prev = NULL;
+  h->root = h->root != NULL ? link (h, h->root, new) : new;
+  h->elem_cnt++;
+}
+
+/* Removes the largest element from heap H and returns it.  If
+   several elements are equally large, returns any of them.
+   Undefined behavior if H is empty. */
+struct heap_elem *
+heap_pop (struct heap *h)
+{
+  struct heap_elem *top;
+
+  ASSERT (!heap_empty (h));
+
+  top = h->root;
+  h->root = merge_pairs (h, top->child);
+  h->elem_cnt--;
+  return top;
+}
+
+/* Removes element E from heap H.  E must be in H.
+
+   An element whose value changes while it is in a heap must be
+   removed and pushed back in, so that it moves to its new
+   place. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  struct heap_elem *sub;
+
+  ASSERT (!heap_empty (h));
+  ASSERT (e != NULL);
+
+  if (e == h->root)
+    {
+      heap_pop (h);
+      return;
+    }
+
+  /* E's children are all at most as large as E, which is itself
+     no larger than the root, so they form a heap of their own
+     that can simply be merged back in. */
+  cut (e);
+  sub = merge_pairs (h, e->child);
+  if (sub != NULL)
+    h->root = link (h, h->root, sub);
+  h->elem_cnt--;
+}
+
+/* Returns the largest element in heap H, without removing it.
+   Undefined behavior if H is empty. */
+struct heap_elem *
+heap_top (const struct heap *h)
+{
+  ASSERT (!heap_empty (h));
+
+  return h->root;
+}
+
+/* Returns the number of elements in heap H. */
+size_t
+heap_size (const struct heap *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if heap H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h)
+{
+  return h->root == NULL;
+}
+
+/* Joins the heaps rooted at A and B, neither of which may have
+   siblings, and returns the root of the result.  A stays on top
+   unless it is less than B. */
+static struct heap_elem *
+link (struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+  struct heap_elem *t;
+
+  if (h->less (a, b, h->aux))
+    {
+      t = a;
+      a = b;
+      b = t;
+    }
+
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  a->next = a->prev = NULL;
+  return a;
+}
+
+/* Joins FIRST and its siblings, each the root of a heap, into a
+   single heap and returns its root, or a null pointer if FIRST
+   is null.  The siblings are linked in pairs from left to right
+   and the pairs are then linked from right to left, which is
+   what keeps the heap's amortized costs logarithmic. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root = NULL;
+
+  /* Link pairs, stacking the results through their NEXT
+     members, so that the rightmost pair ends up first. */
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+
+      if (b != NULL)
+        {
+          first = b->next;
+          a = link (h, a, b);
+        }
+      else
+        {
+          first = NULL;
+          a->prev = NULL;
+        }
+      a->next = pairs;
+      pairs = a;
+    }
+
+  while (pairs != NULL)
+    {
+      struct heap_elem *a = pairs;
+
+      pairs = a->next;
+      a->next = NULL;
+      root = root != NULL ? link (h, root, a) : a;
+    }
+  return root;
+}
+
+/* Detaches element E, together with its children, from its
+   parent and siblings.  E must not be the root of its heap. */
+static void
+cut (struct heap_elem *e)
+{
+  ASSERT (e->prev != NULL);
+
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  e->next = e->prev = NULL;
+}
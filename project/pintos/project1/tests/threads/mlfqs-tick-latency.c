@@ -0,0 +1,72 @@
+/* Measures the cost of the timer interrupt handler in the MLFQS
+   scheduler as the number of threads grows.
+
+   Like mlfqs-load-60, starts up to 60 niced threads that spin
+   in a tight loop.  With 0, 10, 20, ..., 60 of them running,
+   lets the system settle and then samples the average and
+   worst-case number of CPU cycles taken by each timer interrupt
+   over 2 seconds, so that both the per-slice and the
+   once-a-second MLFQS updates are included.
+
+   This is a benchmark, not a pass/fail test: the numbers it
+   prints depend on the host, and it is not part of "make check".
+   Run it with "pintos -- -q -mlfqs run mlfqs-tick-latency". */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 60
+#define THREAD_STEP 10
+
+static volatile int running_cnt;  /* # of load threads started. */
+static volatile int stop_cnt;     /* # of load threads that should stop. */
+
+static void load_thread (void *aux);
+
+void
+test_mlfqs_tick_latency (void) 
+{
+  int thread_cnt;
+
+  ASSERT (thread_mlfqs);
+
+  for (thread_cnt = 0; thread_cnt <= THREAD_CNT; thread_cnt += THREAD_STEP)
+    {
+      uint64_t avg, max;
+
+      /* Start up to THREAD_CNT load threads. */
+      while (running_cnt < thread_cnt)
+        {
+          char name[16];
+          snprintf (name, sizeof name, "load %d", running_cnt);
+          thread_create (name, PRI_DEFAULT, load_thread,
+                         (void *) running_cnt);
+          running_cnt++;
+        }
+
+      timer_sleep (TIMER_FREQ);
+      timer_reset_intr_stats ();
+      timer_sleep (2 * TIMER_FREQ);
+      timer_get_intr_stats (&avg, &max);
+      msg ("%2d threads: %"PRIu64" cycles per tick on average, "
+           "%"PRIu64" at worst.", thread_cnt, avg, max);
+    }
+
+  /* Let the load threads exit. */
+  stop_cnt = THREAD_CNT + 1;
+  timer_sleep (TIMER_FREQ);
+}
+
+static void
+load_thread (void *idx_) 
+{
+  int idx = (int) idx_;
+
+  thread_set_nice (20);
+  while (idx >= stop_cnt)
+    continue;
+}
@@ -0,0 +1,108 @@
+/* Measures the cost of waking the highest-priority waiter of a
+   semaphore and of a condition variable as the number of waiters
+   grows.
+
+   With 1, 4, 16, and 64 threads of assorted priorities blocked on
+   a semaphore, times sema_up() until all of them have been woken,
+   and then does the same for cond_signal().  The waiters all have
+   lower priority than the main thread, so none of them runs until
+   the measurement is over.  Waiters are kept in a heap by
+   priority, so the cost per wakeup should grow only
+   logarithmically with the number of waiters.
+
+   This is a benchmark, not a pass/fail test: the numbers it
+   prints depend on the host, and it is not part of "make check".
+   Run it with "pintos -- -q run priority-wakeup-cost". */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MAX_WAITERS 64
+
+static struct semaphore sema;
+static struct lock lock;
+static struct condition cond;
+
+static void sema_waiter (void *aux);
+static void cond_waiter (void *aux);
+static uint64_t start_waiters (int cnt, thread_func *, struct heap *);
+
+void
+test_priority_wakeup_cost (void) 
+{
+  int cnt;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&sema, 0);
+  lock_init (&lock);
+  cond_init (&cond);
+
+  for (cnt = 1; cnt <= MAX_WAITERS; cnt *= 4)
+    {
+      uint64_t sema_cycles, cond_cycles;
+      int i;
+
+      sema_cycles = start_waiters (cnt, sema_waiter, &sema.waiters);
+      for (i = 0; i < cnt; i++)
+        sema_up (&sema);
+      sema_cycles = timer_read_tsc () - sema_cycles;
+
+      cond_cycles = start_waiters (cnt, cond_waiter, &cond.waiters);
+      lock_acquire (&lock);
+      for (i = 0; i < cnt; i++)
+        cond_signal (&cond, &lock);
+      lock_release (&lock);
+      cond_cycles = timer_read_tsc () - cond_cycles;
+
+      msg ("%2d waiters: %"PRIu64" cycles per sema_up, "
+           "%"PRIu64" per cond_signal.",
+           cnt, sema_cycles / cnt, cond_cycles / cnt);
+    }
+}
+
+/* Starts CNT threads running FUNC, each at a lower priority than
+   ours, waits until all of them are queued in WAITERS, and
+   returns the time-stamp counter at that point. */
+static uint64_t
+start_waiters (int cnt, thread_func *func, struct heap *waiters) 
+{
+  int i;
+
+  /* Let the threads of the last round finish. */
+  timer_sleep (TIMER_FREQ / 10);
+
+  for (i = 0; i < cnt; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "wait %d", i);
+      thread_create (name, PRI_DEFAULT - 1 - i % 16, func, NULL);
+    }
+  while (heap_size (waiters) < (size_t) cnt)
+    timer_sleep (1);
+
+  return timer_read_tsc ();
+}
+
+static void
+sema_waiter (void *aux UNUSED) 
+{
+  sema_down (&sema);
+}
+
+static void
+cond_waiter (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  cond_wait (&cond, &lock);
+  lock_release (&lock);
+}
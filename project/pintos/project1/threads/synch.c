@@ -31,6 +31,25 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/* If true, named locks record how long they are waited for and
+   held.  Controlled by kernel command-line option "-lockprof". */
+bool lock_profiling;
+
+/* List of locks named with lock_set_name(). */
+static struct list named_locks = LIST_INITIALIZER (named_locks);
+
+/* Stamp for the next thread to join a wait queue. */
+static unsigned next_wait_seq;
+
+static void lock_donate (struct lock *, struct thread *);
+static void lock_grant (struct lock *, struct thread *);
+static void lock_record_wait (struct lock *, int64_t start);
+static void sema_enqueue (struct semaphore *, struct thread *);
+static bool sema_less (const struct heap_elem *, const struct heap_elem *,
+                       void *aux);
+static bool waiter_less (const struct thread *, const struct thread *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -47,7 +66,7 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, sema_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -68,7 +87,7 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0)
   {
-    list_insert_ordered (&sema->waiters, &thread_current ()->elem, &thread_less_than, NULL);
+    sema_enqueue (sema, thread_current ());
     thread_block ();
   }
   sema->value--;
@@ -113,17 +132,56 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters))
+  if (!heap_empty (&sema->waiters))
   {
-    /* Sort the list so that highest priority thread is first in waiters. */
-    list_sort (&sema->waiters, &thread_less_than, NULL);
-    thread_unblock (list_entry (list_pop_front (&sema->waiters), struct thread, elem));
+    /* The waiters are kept in a heap by priority, so the top one
+       is the one to wake. */
+    struct thread *t = heap_entry (heap_pop (&sema->waiters),
+                                   struct thread, sema_elem);
+    t->wait_queue = NULL;
+    thread_unblock (t);
   }
   sema->value++;
   thread_checker ();
   intr_set_level (old_level);
 }
 
+/* Adds thread T to SEMA's waiters, in priority order, and
+   records where T is queued in case its priority changes while
+   it waits.  Among threads of equal priority, the one that has
+   waited longest is woken first. */
+static void
+sema_enqueue (struct semaphore *sema, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->wait_seq = next_wait_seq++;
+  heap_push (&sema->waiters, &t->sema_elem);
+  t->wait_queue = &sema->waiters;
+  t->wait_elem = &t->sema_elem;
+}
+
+/* Function for ordering the waiters of a semaphore, so that the
+   top of the heap is the one to wake. */
+static bool
+sema_less (const struct heap_elem *first, const struct heap_elem *second,
+           void *aux UNUSED)
+{
+  return waiter_less (heap_entry (first, struct thread, sema_elem),
+                      heap_entry (second, struct thread, sema_elem));
+}
+
+/* Returns true if waiting thread A should be woken after waiting
+   thread B: if A has lower priority, or the same priority and
+   joined its queue later. */
+static bool
+waiter_less (const struct thread *a, const struct thread *b)
+{
+  if (a->priority != b->priority)
+    return a->priority < b->priority;
+  return (int) (a->wait_seq - b->wait_seq) > 0;
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -183,6 +241,9 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->acquire_cnt = 0;
+  lock->contended_cnt = 0;
+  lock->name = NULL;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -196,60 +257,49 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
-  /* Change? */
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
   enum intr_level old_level = intr_disable ();
   struct thread *current = thread_current ();
-  int priority_update;
+
+  /* Fast path: nobody holds the lock, so there is nobody to wait
+     for or donate to. */
+  lock->acquire_cnt++;
+  if (lock->semaphore.value > 0)
+  {
+    lock->semaphore.value--;
+    lock_grant (lock, current);
+    intr_set_level (old_level);
+    return;
+  }
+  lock->contended_cnt++;
+  int64_t wait_start = lock_profiling ? timer_ticks () : 0;
+
   if (thread_mlfqs)
   {
     sema_down (&lock->semaphore);
-    lock->holder = current;
+    lock_record_wait (lock, wait_start);
+    lock_grant (lock, current);
     intr_set_level (old_level);
     return;
   }
 
-  struct thread *to_change;
-  struct list_elem *e;
-  struct list *lock_waiters;
-  /* If there is a thread blocking the acquiring of this lock, follow to main blocker. */
-  if (lock->holder != NULL)
+  /* While the lock is held, queue up for it and donate our
+     priority down the chain of holders.  This is sema_down() on
+     the lock's semaphore, with the donation done once we are
+     among the waiters. */
+  current->lock_wanted = lock;
+  while (lock->semaphore.value == 0)
   {
-    current->lock_wanted = lock;
-    struct lock *block = lock;
-    /* As long as current priority is max of all the "chain", donating as we go along. */
-    while (block != NULL && current->priority > block->holder->priority)
-    {
-      to_change = block->holder;
-      /* Set first value to current->priority, not to_change->base_priority */
-      priority_update = current->priority;
-      /* Go through waiters of lock and take max of all the priorities. */
-      if (!list_empty (&to_change->locks_held))
-        for (e = list_begin (&to_change->locks_held); e != list_end (&to_change->locks_held); e = list_next (e))
-        {
-          lock_waiters = &(list_entry (e, struct lock, elem)->semaphore).waiters;
-          if (!list_empty (lock_waiters))
-          {
-            list_sort (lock_waiters, &thread_less_than, NULL);
-            priority_update = max (priority_update, list_entry (list_front (lock_waiters), struct thread, elem)->priority);
-          }
-        }
-      /* Donate highest priority to the thread. */
-      to_change->priority = priority_update;
-      /* Move to next lock in the chain. */
-      block = block->holder->lock_wanted;
-    }
-
-    sort_threads ();
+    sema_enqueue (&lock->semaphore, current);
+    lock_donate (lock, current);
+    thread_block ();
   }
-  sema_down (&lock->semaphore);
-
-  /* Successfully acquired lock/semaphore. */
+  lock->semaphore.value--;
 	current->lock_wanted = NULL;
-  list_push_back (&current->locks_held, &lock->elem);
-  lock->holder = current;
+  lock_record_wait (lock, wait_start);
+  lock_grant (lock, current);
   intr_set_level (old_level);
 }
 
@@ -262,17 +312,47 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
-  success = sema_try_down (&lock->semaphore);
+  /* A failed try neither acquires LOCK nor waits for it, so it
+     counts toward neither statistic. */
+  old_level = intr_disable ();
+  success = lock->semaphore.value > 0;
   if (success)
-    lock->holder = thread_current ();
+  {
+    lock->semaphore.value--;
+    lock->acquire_cnt++;
+    lock_grant (lock, thread_current ());
+  }
+  intr_set_level (old_level);
+
   return success;
 }
 
+/* Makes T the holder of LOCK, whose semaphore T has just downed.
+   Any threads still waiting for LOCK now donate to T. */
+static void
+lock_grant (struct lock *lock, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  lock->holder = t;
+  if (lock_profiling && lock->name != NULL)
+    lock->acquired_at = timer_ticks ();
+  if (thread_mlfqs)
+    return;
+
+  /* A lock without waiters donates nothing, so it leaves T's
+     priority alone. */
+  heap_push (&t->locks_held, &lock->elem);
+  if (!heap_empty (&lock->semaphore.waiters))
+    thread_update_priority (t, max (t->priority, lock_priority (lock)));
+}
+
 /* Releases LOCK, which must be owned by the current thread.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -286,39 +366,190 @@ lock_release (struct lock *lock)
   struct thread *current = thread_current ();
 
 	enum intr_level old_level = intr_disable ();
-  if (thread_mlfqs)
+  if (lock_profiling && lock->name != NULL)
   {
-    lock->holder = NULL;
-    sema_up (&lock->semaphore);
+    int64_t held = timer_ticks () - lock->acquired_at;
+    lock->hold_ticks += held;
+    lock->max_hold_ticks = max (lock->max_hold_ticks, held);
+  }
+  lock->holder = NULL;
+  if (!thread_mlfqs)
+    heap_remove (&current->locks_held, &lock->elem);
+
+  /* Fast path: nobody is waiting, so the lock donated nothing and
+     there is nobody to wake. */
+  if (heap_empty (&lock->semaphore.waiters))
+  {
+    lock->semaphore.value++;
     intr_set_level (old_level);
-    thread_checker ();
     return;
   }
-  /* Remove lock from list. */
-  list_remove (&lock->elem);
-  struct list_elem *e;
-  struct list *lock_waiters;
-  /* Recalculate priority of thread using remaining locks. */
-  int priority_update = current->base_priority;
-  if (!list_empty (&current->locks_held))
-    for (e = list_begin (&current->locks_held); e != list_end (&current->locks_held); e = list_next (e))
-    {
-      lock_waiters = &(list_entry (e, struct lock, elem)->semaphore).waiters;
-      if (!list_empty (lock_waiters))
-      {
-        list_sort (lock_waiters, &thread_less_than, NULL);
-        priority_update = max (priority_update, list_entry (list_front (lock_waiters), struct thread, elem)->priority);
-      }
-    }
-  /* Update priority to max priority of all its locks' waiters. */
-  current->priority = priority_update;
 
-  lock->holder = NULL;
+  if (!thread_mlfqs)
+    thread_update_priority (current,
+                            max (current->base_priority,
+                                 lock_donated_priority (current)));
+
   sema_up (&lock->semaphore);
   thread_checker ();
   intr_set_level (old_level);
 }
 
+/* Names LOCK, which makes it show up in lock_print_stats().  Only
+   locks that last until shutdown, such as static ones, should be
+   named.  NAME must also remain valid until then. */
+void
+lock_set_name (struct lock *lock, const char *name)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+
+  old_level = intr_disable ();
+  if (lock->name == NULL)
+  {
+    lock->wait_ticks = lock->max_wait_ticks = 0;
+    lock->hold_ticks = lock->max_hold_ticks = 0;
+    memset (lock->wait_hist, 0, sizeof lock->wait_hist);
+    list_push_back (&named_locks, &lock->prof_elem);
+  }
+  lock->name = name;
+  intr_set_level (old_level);
+}
+
+/* Records that a thread started waiting for LOCK at tick START
+   and has just got it.  Waits go into histogram bucket 0 if they
+   took no ticks, bucket 1 for 1 tick, 2 for 2 or 3 ticks, 3 for
+   4 to 7 ticks, and so on, with the last bucket taking all the
+   longer waits. */
+static void
+lock_record_wait (struct lock *lock, int64_t start)
+{
+  int64_t waited;
+  int bucket;
+
+  if (!lock_profiling || lock->name == NULL)
+    return;
+
+  waited = timer_ticks () - start;
+  lock->wait_ticks += waited;
+  lock->max_wait_ticks = max (lock->max_wait_ticks, waited);
+  for (bucket = 0; bucket < LOCK_HIST_CNT - 1 && waited >> bucket != 0;
+       bucket++)
+    continue;
+  lock->wait_hist[bucket]++;
+}
+
+/* Prints the profile of every named lock, if lock profiling is
+   enabled. */
+void
+lock_print_stats (void)
+{
+  struct list_elem *e;
+  int i;
+
+  if (!lock_profiling)
+    return;
+
+  printf ("Locks: acquires, contended, wait ticks (total/max), "
+          "hold ticks (total/max), waits of 0, 1, 2-3, 4-7... ticks\n");
+  for (e = list_begin (&named_locks); e != list_end (&named_locks);
+       e = list_next (e))
+  {
+    struct lock *lock = list_entry (e, struct lock, prof_elem);
+
+    printf ("%-12s %8u %8u %8lld/%-6lld %8lld/%-6lld",
+            lock->name, lock->acquire_cnt, lock->contended_cnt,
+            lock->wait_ticks, lock->max_wait_ticks,
+            lock->hold_ticks, lock->max_hold_ticks);
+    for (i = 0; i < LOCK_HIST_CNT; i++)
+      printf (" %u", lock->wait_hist[i]);
+    printf ("\n");
+  }
+}
+
+/* Returns the priority of the highest-priority thread waiting
+   for LOCK, or PRI_MIN - 1 if there is none.  A lock's waiters
+   are kept in a heap by priority, so this is the top of it. */
+int
+lock_priority (struct lock *lock)
+{
+  struct heap *waiters = &lock->semaphore.waiters;
+
+  if (heap_empty (waiters))
+    return PRI_MIN - 1;
+  return heap_entry (heap_top (waiters), struct thread, sema_elem)->priority;
+}
+
+/* Returns the highest priority donated to thread T through the
+   locks it holds, or PRI_MIN - 1 if there is none.  T's held
+   locks are kept in a heap by the priority of their top waiter,
+   so this comes from the top of it. */
+int
+lock_donated_priority (struct thread *t)
+{
+  if (heap_empty (&t->locks_held))
+    return PRI_MIN - 1;
+  return lock_priority (heap_entry (heap_top (&t->locks_held),
+                                    struct lock, elem));
+}
+
+/* Function for ordering a thread's held locks by the priority of
+   their top waiter. */
+bool
+lock_less (const struct heap_elem *first, const struct heap_elem *second,
+           void *aux UNUSED)
+{
+  struct lock *f = heap_entry (first, struct lock, elem);
+  struct lock *s = heap_entry (second, struct lock, elem);
+  return lock_priority (f) < lock_priority (s);
+}
+
+/* Donates the priority of thread T, which has just joined LOCK's
+   waiters, to LOCK's holder, and from there on down the chain of
+   locks that holders are themselves waiting for.
+
+   Each lock's waiters and each thread's held locks are kept in
+   heaps by priority, so at every link only the one thread and
+   the one lock whose position changed are moved.  The walk stops as
+   soon as a holder already runs at T's priority. */
+static void
+lock_donate (struct lock *lock, struct thread *t)
+{
+  struct thread *holder;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* T may now be LOCK's top waiter, which may make LOCK the most
+     urgent lock its holder has. */
+  holder = lock->holder;
+  if (holder != NULL)
+  {
+    heap_remove (&holder->locks_held, &lock->elem);
+    heap_push (&holder->locks_held, &lock->elem);
+  }
+
+  while (holder != NULL && t->priority > holder->priority)
+  {
+    /* This also moves HOLDER up in whatever it is waiting for. */
+    thread_update_priority (holder, t->priority);
+    lock = holder->lock_wanted;
+    if (lock == NULL)
+      break;
+
+    /* If HOLDER is waiting for LOCK, it may now be LOCK's top
+       waiter, which may make LOCK the most urgent lock its own
+       holder has. */
+    holder = lock->holder;
+    if (holder != NULL)
+    {
+      heap_remove (&holder->locks_held, &lock->elem);
+      heap_push (&holder->locks_held, &lock->elem);
+    }
+  }
+}
+
 /* Returns true if the current thread holds LOCK, false
    otherwise.  (Note that testing whether some other thread holds
    a lock would be racy.) */
@@ -330,22 +561,23 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem
+/* One thread waiting on a condition variable. */
+struct cond_waiter
   {
-    struct list_elem elem;              /* List element. */
-    struct semaphore semaphore;         /* This semaphore. */
+    struct heap_elem elem;              /* Heap element. */
+    struct thread *thread;              /* Waiting thread. */
+    bool signaled;                      /* Signaled yet? */
   };
 
-/* Function to sort the waiters in a cond. */
+/* Function for ordering the waiters in a cond, so that the top
+   of the heap is the one to signal. */
 bool
-cond_less_than (const struct list_elem *first, const struct list_elem *second, void *aux UNUSED)
+cond_less_than (const struct heap_elem *first,
+                const struct heap_elem *second, void *aux UNUSED)
 {
-  struct semaphore_elem *first_elem = list_entry (first, struct semaphore_elem, elem);
-  struct semaphore_elem *second_elem = list_entry (second, struct semaphore_elem, elem);
-  int first_pri = list_entry (list_front (&first_elem->semaphore.waiters), struct thread, elem)->priority;
-  int second_pri = list_entry (list_front (&second_elem->semaphore.waiters), struct thread, elem)->priority;
-  return first_pri > second_pri;
+  struct cond_waiter *f = heap_entry (first, struct cond_waiter, elem);
+  struct cond_waiter *s = heap_entry (second, struct cond_waiter, elem);
+  return waiter_less (f->thread, s->thread);
 }
 
 /* Initializes condition variable COND.  A condition variable
@@ -356,7 +588,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, cond_less_than, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -382,17 +614,31 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock)
 {
-  struct semaphore_elem waiter;
+  struct cond_waiter waiter;
+  struct thread *current = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  sema_init (&waiter.semaphore, 0);
-  list_insert_ordered (&cond->waiters, &waiter.elem, &thread_less_than, NULL);
+  /* Queue up in priority order before releasing LOCK, so that a
+     signal sent as soon as LOCK is free finds us.  Releasing LOCK
+     may yield, but never blocks, so cond_signal() can tell from
+     our status whether we still need waking up. */
+  waiter.thread = current;
+  waiter.signaled = false;
+  old_level = intr_disable ();
+  current->wait_seq = next_wait_seq++;
+  heap_push (&cond->waiters, &waiter.elem);
+  current->wait_queue = &cond->waiters;
+  current->wait_elem = &waiter.elem;
   lock_release (lock);
-  sema_down (&waiter.semaphore);
+  while (!waiter.signaled)
+    thread_block ();
+  intr_set_level (old_level);
+
   lock_acquire (lock);
 }
 
@@ -411,13 +657,20 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  /* Make sure list isn't empty before we sort. */
-  if (!list_empty (&cond->waiters))
+  /* The waiters are kept in a heap by priority, so the top one
+     is the one to wake. */
+  enum intr_level old_level = intr_disable ();
+  if (!heap_empty (&cond->waiters))
   {
-    list_sort (&cond->waiters, &cond_less_than, NULL);
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    struct cond_waiter *waiter = heap_entry (heap_pop (&cond->waiters),
+                                             struct cond_waiter, elem);
+    waiter->signaled = true;
+    waiter->thread->wait_queue = NULL;
+    if (waiter->thread->status == THREAD_BLOCKED)
+      thread_unblock (waiter->thread);
+    thread_checker ();
   }
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -432,6 +685,6 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
@@ -1,6 +1,7 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
@@ -8,7 +9,7 @@
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -17,12 +18,29 @@ bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+/* Lock profiling.  Controlled by kernel command-line option
+   "-lockprof". */
+extern bool lock_profiling;
+#define LOCK_HIST_CNT 8         /* Buckets in wait-time histogram. */
+
 /* Lock. */
 struct lock 
   {
-  	struct list_elem elem;
+  	struct heap_elem elem;      /* Element in holder's held locks. */
 		struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    unsigned acquire_cnt;       /* Number of times acquired. */
+    unsigned contended_cnt;     /* Number of times found already held. */
+
+    /* Profiling, for locks named with lock_set_name(). */
+    const char *name;           /* Name, or a null pointer. */
+    struct list_elem prof_elem; /* Element in list of named locks. */
+    int64_t acquired_at;        /* Tick at which last acquired. */
+    int64_t wait_ticks;         /* Total ticks spent waiting. */
+    int64_t max_wait_ticks;     /* Longest single wait. */
+    int64_t hold_ticks;         /* Total ticks held. */
+    int64_t max_hold_ticks;     /* Longest single hold. */
+    unsigned wait_hist[LOCK_HIST_CNT]; /* Waits by length, see synch.c. */
   };
 
 void lock_init (struct lock *);
@@ -30,18 +48,25 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+int lock_priority (struct lock *);
+int lock_donated_priority (struct thread *);
+bool lock_less (const struct heap_elem *first,
+                const struct heap_elem *second, void *aux);
+void lock_set_name (struct lock *, const char *name);
+void lock_print_stats (void);
 
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, by priority. */
   };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
-bool cond_less_than (const struct list_elem *first, const struct list_elem *second, void *aux);
+bool cond_less_than (const struct heap_elem *first,
+                     const struct heap_elem *second, void *aux);
 
 /* Optimization barrier.
 
@@ -21,9 +21,18 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue: processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level, and bit P of
+   READY_MASK is set exactly when ready_lists[P] is nonempty, so
+   that both adding a thread and finding the highest-priority
+   ready thread take constant time.  READY_MASK is split into
+   32-bit words, highest priorities in the last word. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+#define MASK_WORDS ((PRI_CNT + 31) / 32)
+static struct list ready_lists[PRI_CNT];
+static uint32_t ready_mask[MASK_WORDS];
+static int ready_cnt;           /* # of threads in the run queue. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -53,6 +62,7 @@ struct kernel_thread_frame
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static struct sched_stats exited_stats; /* Totals of exited threads. */
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
@@ -74,6 +84,12 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static int ready_max_priority (void);
+static struct thread *ready_pop (void);
+static void sched_stats_add (struct sched_stats *, const struct sched_stats *);
+static void print_sched_stats (const struct sched_stats *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -91,10 +107,14 @@ static tid_t allocate_tid (void);
 void
 thread_init (void)
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  lock_set_name (&tid_lock, "tid");
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_lists[i]);
   list_init (&all_list);
 
   /* Set up a thread structure for the running thread. */
@@ -132,7 +152,11 @@ thread_tick (void)
   struct thread *t = thread_current ();
   ASSERT (intr_get_level () == INTR_OFF);
 
-  /* Handle all the updates regarding recent_cpu, priortiy, and load_avg. */
+  /* Handle all the updates regarding recent_cpu, priortiy, and load_avg.
+     Only the running thread's recent_cpu changes from one tick to
+     the next, so only its priority needs recalculating each time
+     slice; everyone else's changes only once a second, when all
+     of them are brought up to date in a single pass. */
   if (thread_mlfqs)
   {
     int64_t ticks = timer_ticks ();
@@ -140,8 +164,12 @@ thread_tick (void)
     /* Once per second calculations. */
     if (ticks % TIMER_FREQ == 0)
     {
+      fixed_point_t decay;
+
       calculate_load_avg ();
-      thread_foreach (&calculate_recent_cpu, NULL);
+      decay = fix_div (fix_scale (load_avg, 2),
+                       fix_add (fix_scale (load_avg, 2), fix_int (1)));
+      thread_foreach (&calculate_recent_cpu, &decay);
     }
 
     /* Increment recent_cpu of current thread if not idle. */
@@ -150,11 +178,13 @@ thread_tick (void)
       t->recent_cpu = fix_add (t->recent_cpu, fix_int (1));
     }
 
-    /* Round robin and recalculate priority every TIME_SLICE ticks. */
+    /* Recalculate priority every TIME_SLICE ticks. */
     if (ticks % TIME_SLICE == 0)
-    {
-      thread_foreach (&calculate_priority, NULL);
-    }
+      calculate_priority (t, NULL);
+
+    /* Some ready thread may now outrank the running one. */
+    if (ready_max_priority () > t->priority)
+      intr_yield_on_return ();
   }
 
   /* Update statistics. */
@@ -166,9 +196,11 @@ thread_tick (void)
 #endif
   else
     kernel_ticks++;
+  if (!thread_mlfqs && t->priority > t->base_priority)
+    t->stats.donated_ticks++;
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE && !list_empty (&ready_list))
+  if (++thread_ticks >= TIME_SLICE && ready_cnt > 0)
     intr_yield_on_return ();
 }
 
@@ -176,8 +208,47 @@ thread_tick (void)
 void
 thread_print_stats (void)
 {
+  struct sched_stats total = exited_stats;
+  struct list_elem *e;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    sched_stats_add (&total, &list_entry (e, struct thread, allelem)->stats);
+  printf ("Scheduler: ");
+  print_sched_stats (&total);
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      printf ("  %s (tid %d): ", t->name, t->tid);
+      print_sched_stats (&t->stats);
+    }
+}
+
+/* Adds the counts in B to A, keeping the larger of the two
+   maximums. */
+static void
+sched_stats_add (struct sched_stats *a, const struct sched_stats *b)
+{
+  a->sched_cnt += b->sched_cnt;
+  a->voluntary_cnt += b->voluntary_cnt;
+  a->involuntary_cnt += b->involuntary_cnt;
+  a->ready_ticks += b->ready_ticks;
+  a->max_wakeup_latency = max (a->max_wakeup_latency, b->max_wakeup_latency);
+  a->donated_ticks += b->donated_ticks;
+}
+
+/* Prints S on one line. */
+static void
+print_sched_stats (const struct sched_stats *s)
+{
+  printf ("%u scheduled, %u voluntary, %u involuntary, "
+          "%lld ready ticks, %lld max wakeup latency, %lld donated ticks\n",
+          s->sched_cnt, s->voluntary_cnt, s->involuntary_cnt,
+          s->ready_ticks, s->max_wakeup_latency, s->donated_ticks);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -274,9 +345,11 @@ thread_unblock (struct thread *t)
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
 
-  /* Put thread into ready list. */
-  list_insert_ordered (&ready_list, &t->elem, &thread_less_than, NULL);
+  /* Put thread into the run queue. */
   t->status = THREAD_READY;
+  t->ready_since = timer_ticks ();
+  t->woken = true;
+  ready_push (t);
   intr_set_level (old_level);
 }
 
@@ -328,6 +401,7 @@ thread_exit (void)
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  sched_stats_add (&exited_stats, &thread_current ()->stats);
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
@@ -346,12 +420,12 @@ thread_yield (void)
 
   old_level = intr_disable ();
 
-  /* As long as idle thread doesn't yield, add to ready_list. */
-  sort_threads ();
+  /* As long as idle thread doesn't yield, add to the run queue. */
+  cur->status = THREAD_READY;
+  cur->ready_since = timer_ticks ();
   if (cur != idle_thread)
-    list_insert_ordered (&ready_list, &cur->elem, &thread_less_than, NULL);
+    ready_push (cur);
 
-  cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
 }
@@ -386,24 +460,9 @@ thread_set_priority (int new_priority)
   /* Recalculate thread's priority based on locks_held. */
 	current->base_priority = new_priority;
 
-  int priority_update = new_priority;
-  struct list_elem *e;
-  struct list *lock_waiters;
-  /* Go through all the locks and take the max of all its waiters. */
-  if (!list_empty (&current->locks_held))
-  for (e = list_begin (&current->locks_held); e != list_end (&current->locks_held); e = list_next (e))
-  {
-    /* Take the lock's waiters and take the max of all the priorities. */
-    lock_waiters = &(list_entry (e, struct lock, elem)->semaphore).waiters;
-    if (!list_empty (lock_waiters))
-    {
-      /* Make sure that we only have to pull the first waiter. */
-      list_sort (lock_waiters, &thread_less_than, NULL);
-      priority_update = max (priority_update, list_entry (list_front (lock_waiters), struct thread, elem)->priority);
-    }
-  }
   /* Update priority to be max of base and all lock's max waiters. */
-  current->priority = priority_update;
+  thread_update_priority (current,
+                          max (new_priority, lock_donated_priority (current)));
   thread_checker ();
   intr_set_level (old_level);
 }
@@ -455,17 +514,19 @@ thread_get_load_avg (void)
   return fix_round (fix_scale (load_avg, 100));
 }
 
-/* Calculate new recent cpu of desired thread. */
-void calculate_recent_cpu (struct thread *to_change, void *aux UNUSED)
+/* Calculate new recent cpu of desired thread, then its new priority.
+   AUX points to the decay factor, (2*load_avg)/(2*load_avg + 1),
+   which is the same for every thread and so is worked out once by
+   the caller. */
+void calculate_recent_cpu (struct thread *to_change, void *aux)
 {
+  const fixed_point_t *decay = aux;
   if (to_change == idle_thread)
     return;
-  fixed_point_t bottom = fix_add (fix_scale (load_avg, 2), fix_int (1));
-  fixed_point_t top = fix_scale (load_avg, 2);
-  fixed_point_t division = fix_div (top, bottom);
-  fixed_point_t result = fix_mul (division, to_change->recent_cpu);
+  fixed_point_t result = fix_mul (*decay, to_change->recent_cpu);
   result = fix_add (result, fix_int (to_change->nice));
   to_change->recent_cpu = result;
+  calculate_priority (to_change, NULL);
 }
 
 /* Calculate new priority. */
@@ -480,13 +541,14 @@ void calculate_priority (struct thread *to_change, void *aux UNUSED)
   if (p > PRI_MAX)
     p = PRI_MAX;
 
-  to_change->priority = p;
+  thread_update_priority (to_change, p);
 }
 
-/* Calculating new load avg. */
+/* Calculating new load avg, using the count of ready threads the
+   run queue maintains. */
 void calculate_load_avg (void)
 {
-  int size = list_size (&ready_list);
+  int size = ready_cnt;
   /* If current thread is not idle, add one since it is also "ready". */
   if (thread_current () != idle_thread)
     size++;
@@ -581,7 +643,6 @@ init_thread (struct thread *t, const char *name, int priority)
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->magic = THREAD_MAGIC;
-	t->wake_time = 0;
   if (thread_mlfqs)
   {
     /* If MLFQS, we want to set nice and recent_cpu values. */
@@ -605,7 +666,7 @@ init_thread (struct thread *t, const char *name, int priority)
     t->priority = priority;
 		t->base_priority = priority;
 	}
-	list_init (&t->locks_held);
+	heap_init (&t->locks_held, lock_less, NULL);
 	sema_init (&t->sema, 0);
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -633,11 +694,10 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void)
 {
-  if (list_empty (&ready_list))
+  if (ready_cnt == 0)
     return idle_thread;
   else
-    sort_threads ();
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    return ready_pop ();
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -669,6 +729,21 @@ thread_schedule_tail (struct thread *prev)
   /* Start new time slice. */
   thread_ticks = 0;
 
+  /* Account for the time we spent in the run queue. */
+  if (prev != NULL)
+    {
+      cur->stats.sched_cnt++;
+      if (cur != idle_thread)
+        {
+          int64_t waited = timer_ticks () - cur->ready_since;
+          cur->stats.ready_ticks += waited;
+          if (cur->woken)
+            cur->stats.max_wakeup_latency
+              = max (cur->stats.max_wakeup_latency, waited);
+        }
+      cur->woken = false;
+    }
+
 #ifdef USERPROG
   /* Activate the new address space. */
   process_activate ();
@@ -705,7 +780,13 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      if (cur->status == THREAD_READY)
+        cur->stats.involuntary_cnt++;
+      else
+        cur->stats.voluntary_cnt++;
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -723,7 +804,7 @@ allocate_tid (void)
   return tid;
 }
 
-/* Function for sorting threads in ready_list. (Highest priority first) */
+/* Function for ordering threads by priority. (Highest priority first) */
 bool
 thread_less_than (const struct list_elem *first, const struct list_elem *second, void *aux UNUSED)
 {
@@ -734,17 +815,33 @@ thread_less_than (const struct list_elem *first, const struct list_elem *second,
   return (f->priority > s->priority);
 }
 
-/* Quick call to sorting threads, make sure that ready_list isn't empty. */
-/* Returns true if not empty, false if is empty. */
-bool
-sort_threads (void)
+/* Sets T's priority to PRIORITY.  If T is in the run queue, it
+   moves to the back of the queue for its new priority.  If T is
+   in a wait queue, it moves to its new place in that queue. */
+void
+thread_update_priority (struct thread *t, int priority)
 {
-  if (!list_empty (&ready_list))
-  {
-    list_sort (&ready_list, &thread_less_than, NULL);
-    return true;
-  }
-  return false;
+  enum intr_level old_level;
+
+  ASSERT (is_thread (t));
+  ASSERT (priority >= PRI_MIN && priority <= PRI_MAX);
+
+  old_level = intr_disable ();
+  if (t->status == THREAD_READY && t != idle_thread
+      && t->priority != priority)
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
+  else
+    t->priority = priority;
+  if (t->wait_queue != NULL)
+    {
+      heap_remove (t->wait_queue, t->wait_elem);
+      heap_push (t->wait_queue, t->wait_elem);
+    }
+  intr_set_level (old_level);
 }
 
 /* Function to check whether we should yield to a higher priority thread. */
@@ -753,13 +850,76 @@ thread_checker (void)
 {
   enum intr_level old_level = intr_disable ();
 
-  if (sort_threads ())
-    if (list_entry (list_front (&ready_list), struct thread, elem)->priority > thread_current ()->priority)
-      thread_yield ();
+  if (ready_max_priority () > thread_current ()->priority)
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
+    }
 
   intr_set_level (old_level);
 }
 
+/* Adds T, which must be ready, to the back of the run queue for
+   its priority. */
+static void
+ready_push (struct thread *t)
+{
+  int pri = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_push_back (&ready_lists[pri], &t->elem);
+  ready_mask[pri / 32] |= 1u << (pri % 32);
+  ready_cnt++;
+}
+
+/* Removes T from the run queue. */
+static void
+ready_remove (struct thread *t)
+{
+  int pri = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_lists[pri]))
+    ready_mask[pri / 32] &= ~(1u << (pri % 32));
+  ready_cnt--;
+}
+
+/* Returns the highest priority of any thread in the run queue,
+   or PRI_MIN - 1 if the run queue is empty. */
+static int
+ready_max_priority (void)
+{
+  int word;
+
+  for (word = MASK_WORDS - 1; word >= 0; word--)
+    if (ready_mask[word] != 0)
+      return word * 32 + (31 - __builtin_clz (ready_mask[word])) + PRI_MIN;
+  return PRI_MIN - 1;
+}
+
+/* Removes and returns the thread that has waited longest among
+   the highest-priority threads in the run queue, which must not
+   be empty. */
+static struct thread *
+ready_pop (void)
+{
+  int pri = ready_max_priority ();
+  struct thread *t;
+
+  ASSERT (pri >= PRI_MIN);
+
+  t = list_entry (list_front (&ready_lists[pri - PRI_MIN]),
+                  struct thread, elem);
+  ready_remove (t);
+  return t;
+}
+
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
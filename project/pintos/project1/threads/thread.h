@@ -2,6 +2,7 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
 #include <stdint.h>
 #include "threads/synch.h"
@@ -32,6 +33,18 @@ typedef int tid_t;
 
 #define max(a,b) (((a)>(b))?(a):(b))
 
+/* Scheduling statistics for a thread.  Times are in timer
+   ticks. */
+struct sched_stats
+  {
+    unsigned sched_cnt;                 /* Times switched to. */
+    unsigned voluntary_cnt;             /* Switches away by blocking. */
+    unsigned involuntary_cnt;           /* Switches away while runnable. */
+    int64_t ready_ticks;                /* Total time in the run queue. */
+    int64_t max_wakeup_latency;         /* Longest unblock to running. */
+    int64_t donated_ticks;              /* Time run with donated priority. */
+  };
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -97,14 +110,13 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     struct list_elem allelem;           /* List element for all threads list. */
-		int64_t wake_time;
 		struct semaphore sema;
 
 		/* Variables added for task 2 */
 		//int effective_priority;
     int base_priority;                  /* Make sure we have a priority we can revert back to. */
 		struct lock * lock_wanted;
-		struct list locks_held;
+		struct heap locks_held;
 
 
     /* Shared between thread.c and synch.c. */
@@ -113,6 +125,20 @@ struct thread
     int nice;                           /* Nice Value. */
     fixed_point_t recent_cpu;           /* Thread recent_cpu. */
 
+    /* Shared between thread.c and synch.c.  While the thread is
+       queued in one of synch.c's priority-ordered wait queues, the
+       queue and its element in it, so that a change of priority
+       can move it to its new place. */
+    struct heap *wait_queue;            /* Queue, or a null pointer. */
+    struct heap_elem *wait_elem;        /* Element in WAIT_QUEUE. */
+    struct heap_elem sema_elem;         /* Element in semaphore queue. */
+    unsigned wait_seq;                  /* Orders equal priorities. */
+
+    /* Owned by thread.c. */
+    struct sched_stats stats;           /* Scheduling statistics. */
+    int64_t ready_since;                /* Tick last put in run queue. */
+    bool woken;                         /* Unblocked since last run? */
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
@@ -163,9 +189,9 @@ void calculate_recent_cpu (struct thread *to_change, void *aux);
 void calculate_priority (struct thread *to_change, void *aux);
 void calculate_load_avg (void);
 
-/* Function for sorting ready_list. */
+/* Function for ordering threads by priority. */
 bool thread_less_than (const struct list_elem *first, const struct list_elem *second, void *aux);
-bool sort_threads (void);
+void thread_update_priority (struct thread *, int priority);
 
 void thread_checker (void);
 #endif /* threads/thread.h */
@@ -165,6 +165,16 @@ timer_print_stats (void)
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
+
+/* Returns the CPU's time-stamp counter, which counts clock
+   cycles.  Useful for timing things much shorter than a tick. */
+uint64_t
+timer_read_tsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
 
 /* Timer interrupt handler. */
 static void
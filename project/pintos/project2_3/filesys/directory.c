@@ -273,6 +273,21 @@ dir_remove (struct dir *dir, const char *name)
   return success;
 }
 
+/* Sets the position in DIR at which dir_readdir() continues to
+   POS, as returned by dir_tell(). */
+void
+dir_seek (struct dir *dir, off_t pos)
+{
+  dir->pos = pos;
+}
+
+/* Returns the position in DIR at which dir_readdir() continues. */
+off_t
+dir_tell (const struct dir *dir)
+{
+  return dir->pos;
+}
+
 /* Reads the next directory entry in DIR and stores the name in
    NAME.  Returns true if successful, false if the directory
    contains no more entries. */
@@ -27,6 +27,7 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  file_init ();
   cache_init ();
   free_map_init ();
 
@@ -93,22 +94,19 @@ filesys_open (const char *name)
   if (dir != NULL)
   {
     if (strcmp (file_name, "..") == 0)
-    {
       inode = dir_get_parent (dir);
-      if (inode == NULL)
-        return NULL;
-    }
     else if ((dir_is_root (dir) && strlen (file_name) == 0) || strcmp(file_name, ".") == 0)
-      return (struct file *) dir;
+      inode = inode_reopen (dir_get_inode (dir));
     else
       dir_lookup (dir, file_name, &inode);
   }
 
+  /* Directories are opened as files too, so that file descriptors
+     only ever refer to files.  dir_seek() and dir_tell() let a
+     directory be read through one. */
   dir_close (dir);
   if (inode == NULL)
     return NULL;
-  if (inode_is_dir (inode))
-    return (struct file *) dir_open(inode);
   return file_open (inode);
 }
 
@@ -169,6 +167,7 @@ cache_entry_init (struct cache_entry *ent)
   ent->dirty = false;
   ent->valid = false;
   lock_init(&(ent->data_lock));
+  lock_set_name (&ent->data_lock, "cache-data");
 }
 
 void 
@@ -176,6 +175,7 @@ cache_init (void)
 {
   clock_hand = 0;
   lock_init (&metadata_lock);
+  lock_set_name (&metadata_lock, "cache-meta");
   hit_cnt = 0;
   miss_cnt = 0;
   int i;
@@ -5,9 +5,14 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -49,6 +54,8 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    unsigned write_cnt;                 /* Number of completed writes. */
+    int writer_cnt;                     /* Number of writes under way. */
     struct inode_disk data;             /* Inode content. */
     
     struct lock inode_lock;
@@ -102,11 +109,23 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of in-memory inodes. */
+static struct slab_cache inode_cache;
+
+/* Constructor for inode_cache. */
+static void
+inode_ctor (void *inode_)
+{
+  struct inode *inode = inode_;
+  lock_init (&inode->inode_lock);
+}
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  slab_cache_init (&inode_cache, "inode", sizeof (struct inode), inode_ctor);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -166,7 +185,7 @@ inode_open (block_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = slab_alloc (&inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -175,8 +194,9 @@ inode_open (block_sector_t sector)
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
+  inode->write_cnt = 0;
+  inode->writer_cnt = 0;
   inode->removed = false;
-  lock_init (&inode->inode_lock);
 
   cache_read (inode->sector, &inode->data);
 
@@ -224,7 +244,7 @@ inode_close (struct inode *inode)
     {
       cache_write (inode->sector, &inode->data);
     }
-    free (inode); 
+    slab_free (&inode_cache, inode); 
   }
 }
 
@@ -235,15 +255,133 @@ inode_remove (struct inode *inode)
 {
   ASSERT (inode != NULL);
   inode->removed = true;
+#ifdef USERPROG
+  /* Don't let a cached executable keep INODE's sectors in use. */
+  process_forget_exe (inode);
+#endif
+}
+
+/* A position within an I/O vector. */
+struct iov_iter
+  {
+    const struct iovec *iov;    /* Current buffer. */
+    const struct iovec *end;    /* End of vector. */
+    size_t ofs;                 /* Offset within current buffer. */
+  };
+
+/* Initializes IT to the start of the CNT buffers in IOV, and
+   returns their total length. */
+static off_t
+iov_iter_init (struct iov_iter *it, const struct iovec *iov, int cnt)
+{
+  off_t size = 0;
+  int i;
+
+  it->iov = iov;
+  it->end = iov + cnt;
+  it->ofs = 0;
+  for (i = 0; i < cnt; i++)
+    size += iov[i].iov_len;
+  return size;
+}
+
+/* Skips past empty buffers in IT. */
+static void
+iov_iter_skip_empty (struct iov_iter *it)
+{
+  while (it->iov < it->end && it->ofs >= it->iov->iov_len)
+    {
+      it->iov++;
+      it->ofs = 0;
+    }
+}
+
+/* If the next SIZE bytes of IT lie in a single buffer, returns
+   their address and advances IT past them.  Otherwise, returns a
+   null pointer. */
+static void *
+iov_iter_span (struct iov_iter *it, size_t size)
+{
+  void *p;
+
+  iov_iter_skip_empty (it);
+  if (it->iov == it->end || it->iov->iov_len - it->ofs < size)
+    return NULL;
+  p = (uint8_t *) it->iov->iov_base + it->ofs;
+  it->ofs += size;
+  return p;
+}
+
+/* Copies SIZE bytes from SRC into the buffers at IT, and
+   advances IT past them. */
+static void
+iov_iter_put (struct iov_iter *it, const void *src_, size_t size)
+{
+  const uint8_t *src = src_;
+
+  while (size > 0)
+    {
+      size_t chunk;
+
+      iov_iter_skip_empty (it);
+      ASSERT (it->iov < it->end);
+      chunk = it->iov->iov_len - it->ofs;
+      if (chunk > size)
+        chunk = size;
+      memcpy ((uint8_t *) it->iov->iov_base + it->ofs, src, chunk);
+      it->ofs += chunk;
+      src += chunk;
+      size -= chunk;
+    }
+}
+
+/* Copies SIZE bytes from the buffers at IT into DST, and
+   advances IT past them. */
+static void
+iov_iter_get (struct iov_iter *it, void *dst_, size_t size)
+{
+  uint8_t *dst = dst_;
+
+  while (size > 0)
+    {
+      size_t chunk;
+
+      iov_iter_skip_empty (it);
+      ASSERT (it->iov < it->end);
+      chunk = it->iov->iov_len - it->ofs;
+      if (chunk > size)
+        chunk = size;
+      memcpy (dst, (const uint8_t *) it->iov->iov_base + it->ofs, chunk);
+      it->ofs += chunk;
+      dst += chunk;
+      size -= chunk;
+    }
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
 off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset) 
 {
-  uint8_t *buffer = buffer_;
+  struct iovec iov;
+
+  iov.iov_base = buffer;
+  iov.iov_len = size;
+  return inode_readv_at (inode, &iov, 1, offset);
+}
+
+/* Reads from INODE, starting at position OFFSET, into the CNT
+   buffers in IOV in order, filling each before going on to the
+   next.  Returns the number of bytes actually read, which may be
+   less than the buffers' total length if an error occurs or end
+   of file is reached. */
+off_t
+inode_readv_at (struct inode *inode, const struct iovec *iov, int cnt,
+                off_t offset) 
+{
+  struct iov_iter it;
+  off_t size = iov_iter_init (&it, iov, cnt);
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
@@ -252,6 +390,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       /* Disk sector to read, starting byte offset within sector. */
       block_sector_t sector_idx = byte_to_sector (inode, offset);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+      void *direct;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
       off_t inode_left = inode_length (inode) - offset;
@@ -263,15 +402,16 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE
+          && (direct = iov_iter_span (&it, BLOCK_SECTOR_SIZE)) != NULL)
         {
           /* Read full sector directly into caller's buffer. */
-          cache_read (sector_idx, buffer + bytes_read);
+          cache_read (sector_idx, direct);
         }
       else
         {
           /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
+             into caller's buffers. */
           if (bounce == NULL)
             {
               bounce = malloc (BLOCK_SECTOR_SIZE);
@@ -279,7 +419,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
                 break;
             }
           cache_read (sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+          iov_iter_put (&it, bounce + sector_ofs, chunk_size);
         }
       
       /* Advance. */
@@ -298,16 +438,40 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
    (Normally a write at end of file would extend the inode, but
    growth is not yet implemented.) */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
                 off_t offset)
 {
-  const uint8_t *buffer = buffer_;
+  struct iovec iov;
+
+  iov.iov_base = (void *) buffer;
+  iov.iov_len = size;
+  return inode_writev_at (inode, &iov, 1, offset);
+}
+
+/* Writes the CNT buffers in IOV, in order, into INODE, starting
+   at OFFSET, extending INODE once for all of them if needed.
+   Returns the number of bytes actually written, which may be
+   less than the buffers' total length if an error occurs. */
+off_t
+inode_writev_at (struct inode *inode, const struct iovec *iov, int cnt,
+                 off_t offset)
+{
+  struct iov_iter it;
+  off_t size = iov_iter_init (&it, iov, cnt);
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
+  enum intr_level old_level;
 
   if (inode->deny_write_cnt)
     return 0;
 
+  /* Counted as under way until the data is all written, then as
+     completed, so that inode_get_write_cnt() never reports a
+     partly written INODE as unchanged. */
+  old_level = intr_disable ();
+  inode->writer_cnt++;
+  intr_set_level (old_level);
+
   if (offset + size > inode_length (inode)) {
     if (!inode->data.is_dir)
       lock_acquire (&inode->inode_lock);
@@ -325,6 +489,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       /* Sector to write, starting byte offset within sector. */
       block_sector_t sector_idx = byte_to_sector (inode, offset);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+      void *direct;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
       off_t inode_left = inode_length (inode) - offset;
@@ -336,10 +501,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE
+          && (direct = iov_iter_span (&it, BLOCK_SECTOR_SIZE)) != NULL)
         {
           /* Write full sector directly to disk. */
-          cache_write (sector_idx, buffer + bytes_written);
+          cache_write (sector_idx, direct);
         }
       else 
         {
@@ -358,7 +524,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
             cache_read (sector_idx, bounce);
           else
             memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
+          iov_iter_get (&it, bounce + sector_ofs, chunk_size);
           cache_write (sector_idx, bounce);
         }
 
@@ -369,6 +535,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
     }
   free (bounce);
 
+  old_level = intr_disable ();
+  inode->writer_cnt--;
+  inode->write_cnt++;
+  intr_set_level (old_level);
+
   return bytes_written;
 }
 
@@ -546,6 +717,23 @@ int inode_get_open_cnt (const struct inode *inode) {
   return inode->open_cnt;
 }
 
+/* Returns the number of writes to INODE completed since it was
+   opened.  Comparing two values tells whether its contents may
+   have changed in between, as long as INODE stayed open and
+   inode_is_being_written() was false both times. */
+unsigned
+inode_get_write_cnt (const struct inode *inode)
+{
+  return inode->write_cnt;
+}
+
+/* Returns true if a write to INODE is under way. */
+bool
+inode_is_being_written (const struct inode *inode)
+{
+  return inode->writer_cnt > 0;
+}
+
 bool
 inode_is_dir (const struct inode *inode)
 {
@@ -60,6 +60,76 @@ byte_cnt (size_t bit_cnt)
   return sizeof (elem_type) * elem_cnt (bit_cnt);
 }
 
+/* Returns an elem_type in which the bits numbered LO through
+   HI - 1 within an element are set to 1 and the rest are set to
+   0.  Requires LO < HI <= ELEM_BITS. */
+static inline elem_type
+range_mask (size_t lo, size_t hi)
+{
+  elem_type high = hi < ELEM_BITS ? bit_mask (hi) - 1 : (elem_type) -1;
+  return high & ~(bit_mask (lo) - 1);
+}
+
+/* Returns the number, within element IDX, of the bit just past
+   the last bit of that element that comes before bit END, for
+   use as the HI argument to range_mask().  Requires that some
+   bit of element IDX comes before END. */
+static inline size_t
+last_bit_in_elem (size_t idx, size_t end)
+{
+  size_t left = end - idx * ELEM_BITS;
+  return left < ELEM_BITS ? left : ELEM_BITS;
+}
+
+/* Returns the element of B with index IDX, with its bits
+   inverted if VALUE is false, so that bits equal to VALUE read
+   as 1. */
+static inline elem_type
+elem_value (const struct bitmap *b, size_t idx, bool value)
+{
+  return value ? b->bits[idx] : ~b->bits[idx];
+}
+
+/* Returns the number of 1-bits in WORD.  The kernel is not
+   linked with libgcc, so __builtin_popcountl() is not available;
+   this is the usual parallel bit count for a 32-bit word. */
+static inline size_t
+popcount (elem_type word)
+{
+  word = word - ((word >> 1) & 0x55555555);
+  word = (word & 0x33333333) + ((word >> 2) & 0x33333333);
+  word = (word + (word >> 4)) & 0x0f0f0f0f;
+  return (word * 0x01010101) >> 24;
+}
+
+/* Returns the index of the first bit at or after START and
+   before END in B that is set to VALUE, or END if there is none.
+   Looks at a whole element at a time. */
+static size_t
+find_next (const struct bitmap *b, size_t start, size_t end, bool value)
+{
+  size_t idx, last_idx;
+  elem_type word;
+
+  if (start >= end)
+    return end;
+
+  idx = elem_idx (start);
+  last_idx = elem_idx (end - 1);
+  word = elem_value (b, idx, value) & ~(bit_mask (start) - 1);
+  for (;;)
+    {
+      if (word != 0)
+        {
+          size_t bit = idx * ELEM_BITS + __builtin_ctzl (word);
+          return bit < end ? bit : end;
+        }
+      if (idx == last_idx)
+        return end;
+      word = elem_value (b, ++idx, value);
+    }
+}
+
 /* Returns a bit mask in which the bits actually used in the last
    element of B's bits are set to 1 and the rest are set to 0. */
 static inline elem_type
@@ -217,14 +287,28 @@ bitmap_set_all (struct bitmap *b, bool value)
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
+  size_t end = start + cnt;
   size_t i;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  /* Each element is updated atomically, as in bitmap_mark() and
+     bitmap_reset(), but the run as a whole is not. */
+  for (i = start; i < end; )
+    {
+      size_t idx = elem_idx (i);
+      size_t lo = i % ELEM_BITS;
+      size_t hi = last_bit_in_elem (idx, end);
+      elem_type mask = range_mask (lo, hi);
+
+      if (value)
+        asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+      i = (idx + 1) * ELEM_BITS;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -232,6 +316,7 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
+  size_t end = start + cnt;
   size_t i, value_cnt;
 
   ASSERT (b != NULL);
@@ -239,9 +324,15 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (start + cnt <= b->bit_cnt);
 
   value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
+  for (i = start; i < end; )
+    {
+      size_t idx = elem_idx (i);
+      size_t lo = i % ELEM_BITS;
+      size_t hi = last_bit_in_elem (idx, end);
+
+      value_cnt += popcount (elem_value (b, idx, value) & range_mask (lo, hi));
+      i = (idx + 1) * ELEM_BITS;
+    }
   return value_cnt;
 }
 
@@ -250,16 +341,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_next (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -298,13 +384,28 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
+  if (cnt == 0)
+    return start;
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t i = start;
+
+      /* Find the next bit set to VALUE, then the first bit within
+         CNT of it that is not.  If there is one, no run can start
+         before it, so resume the search just past it. */
+      while (i <= last)
+        {
+          size_t block;
+
+          i = find_next (b, i, last + 1, value);
+          if (i > last)
+            break;
+          block = find_next (b, i, i + cnt, !value);
+          if (block == i + cnt)
+            return i;
+          i = block + 1;
+        }
     }
   return BITMAP_ERROR;
 }
@@ -0,0 +1,15 @@
+#ifndef __LIB_MEMSTAT_H
+#define __LIB_MEMSTAT_H
+
+/* Memory usage of a process, as reported by the memstat system
+   call.  Sizes are in pages. */
+struct memstat
+  {
+    int rss;                    /* Resident pages, private or shared. */
+    int wss;                    /* Working-set estimate. */
+    unsigned page_faults;       /* Page faults taken. */
+    unsigned pages_in;          /* Pages read back from swap. */
+    unsigned pages_out;         /* Pages evicted to swap. */
+  };
+
+#endif /* lib/memstat.h */
@@ -1,5 +1,38 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The functions below that handle blocks of memory work a 32-bit
+   word at a time once they have done enough single bytes to
+   bring a pointer to a word boundary.  Short blocks are not worth
+   the setup and are done a byte at a time. */
+
+/* A word of memory that may alias any other type. */
+typedef uint32_t word_t __attribute__ ((may_alias));
+
+/* Blocks shorter than this are handled a byte at a time. */
+#define SHORT_BLOCK 16
+
+/* Returns a word with each byte set to BYTE. */
+static inline word_t
+spread_byte (unsigned char byte) 
+{
+  return byte * 0x01010101u;
+}
+
+/* Returns nonzero if some byte of W is zero. */
+static inline word_t
+has_zero_byte (word_t w) 
+{
+  return (w - 0x01010101u) & ~w & 0x80808080u;
+}
+
+/* Returns the number of bytes from P to the next word boundary. */
+static inline size_t
+bytes_to_word (const void *p) 
+{
+  return -(uintptr_t) p & (sizeof (word_t) - 1);
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +45,22 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= SHORT_BLOCK) 
+    {
+      /* Align DST, then copy whole words. */
+      size_t head = bytes_to_word (dst);
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = *src++;
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words)
+                    : : "memory");
+    }
+
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -58,6 +107,22 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  if (size >= SHORT_BLOCK) 
+    {
+      /* Align A, then skip whole words that are equal.  The
+         bytes of the first unequal word, if any, are compared
+         below. */
+      size_t head = bytes_to_word (a);
+
+      for (; head > 0; head--, size--, a++, b++)
+        if (*a != *b)
+          return *a > *b ? +1 : -1;
+      for (; size >= sizeof (word_t);
+           size -= sizeof (word_t), a += sizeof (word_t), b += sizeof (word_t))
+        if (*(const word_t *) a != *(const word_t *) b)
+          break;
+    }
+
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -98,6 +163,22 @@ memchr (const void *block_, int ch_, size_t size)
 
   ASSERT (block != NULL || size == 0);
 
+  if (size >= SHORT_BLOCK) 
+    {
+      /* Align BLOCK, then skip whole words that do not contain
+         CH. */
+      word_t pattern = spread_byte (ch);
+      size_t head = bytes_to_word (block);
+
+      for (; head > 0; head--, size--, block++)
+        if (*block == ch)
+          return (void *) block;
+      for (; size >= sizeof (word_t);
+           size -= sizeof (word_t), block += sizeof (word_t))
+        if (has_zero_byte (*(const word_t *) block ^ pattern))
+          break;
+    }
+
   for (; size-- > 0; block++)
     if (*block == ch)
       return (void *) block;
@@ -281,6 +362,23 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
+
+  if (size >= SHORT_BLOCK) 
+    {
+      /* Align DST, then store whole words. */
+      size_t head = bytes_to_word (dst);
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = value;
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words)
+                    : "a" (spread_byte (value))
+                    : "memory");
+    }
   
   while (size-- > 0)
     *dst++ = value;
@@ -296,8 +394,16 @@ strlen (const char *string)
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
-    continue;
+  /* Check single bytes up to a word boundary, then whole words.
+     An aligned word never straddles a page boundary, so reading
+     past the null terminator within its word cannot fault. */
+  for (p = string; bytes_to_word (p) != 0; p++)
+    if (*p == '\0')
+      return p - string;
+  while (!has_zero_byte (*(const word_t *) p))
+    p += sizeof (word_t);
+  while (*p != '\0')
+    p++;
   return p - string;
 }
 
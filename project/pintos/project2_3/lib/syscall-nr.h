@@ -35,8 +35,18 @@ enum
     SYS_MISS,
     SYS_READ_CNT,
     SYS_WRITE_CNT,
-    SYS_RESET_READ_CNT
+    SYS_RESET_READ_CNT,
 
+    SYS_FORK,                   /* Clone this process. */
+    SYS_MEMSTAT,                /* Report memory usage. */
+    SYS_DUP2,                   /* Duplicate a file descriptor. */
+    SYS_READV,                  /* Read into several buffers. */
+    SYS_WRITEV,                 /* Write from several buffers. */
+    SYS_PREAD,                  /* Read at a given file offset. */
+    SYS_PWRITE,                 /* Write at a given file offset. */
+    SYS_RING_SETUP,             /* Register a system call ring. */
+    SYS_RING_ENTER,             /* Run the calls queued on the ring. */
+    SYS_WAIT_ANY                /* Wait for any child process to die. */
   };
 
 #endif /* lib/syscall-nr.h */
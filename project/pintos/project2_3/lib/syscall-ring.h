@@ -0,0 +1,52 @@
+#ifndef __LIB_SYSCALL_RING_H
+#define __LIB_SYSCALL_RING_H
+
+#include <stdint.h>
+
+/* A ring of system calls shared between a user program and the
+   kernel, so that the program can queue many calls and have the
+   kernel run them all with a single trap.
+
+   The program writes requests into SQ, then advances SQ_TAIL
+   past them.  The ring_enter system call runs the requests from
+   SQ_HEAD up to SQ_TAIL in order, writes a completion for each
+   into CQ, and advances SQ_HEAD and CQ_TAIL.  The program reads
+   completions from CQ_HEAD up to CQ_TAIL and advances CQ_HEAD.
+   The counters run freely; a slot is found by reducing one
+   modulo RING_ENTRIES.
+
+   Any system call that does not start, wait for or end a process
+   may be queued.  A queued call behaves as if it had been made
+   directly, including killing the process for a bad pointer. */
+
+/* Number of slots in each half of a ring.  A power of 2. */
+#define RING_ENTRIES 32
+
+/* A queued system call. */
+struct ring_sqe
+  {
+    uint32_t nr;                /* System call number. */
+    uint32_t args[4];           /* Arguments. */
+    uint32_t user_data;         /* Copied into the completion. */
+  };
+
+/* A completed system call. */
+struct ring_cqe
+  {
+    uint32_t user_data;         /* From the request. */
+    int32_t result;             /* Return value; -1 if NR is not
+                                   allowed on a ring. */
+  };
+
+/* A system call ring. */
+struct syscall_ring
+  {
+    uint32_t sq_head;           /* Next request to run. */
+    uint32_t sq_tail;           /* Next free request slot. */
+    uint32_t cq_head;           /* Next completion to read. */
+    uint32_t cq_tail;           /* Next free completion slot. */
+    struct ring_sqe sq[RING_ENTRIES]; /* Requests. */
+    struct ring_cqe cq[RING_ENTRIES]; /* Completions. */
+  };
+
+#endif /* lib/syscall-ring.h */
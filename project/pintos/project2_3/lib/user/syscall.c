@@ -61,6 +61,25 @@
           retval;                                               \
         })
 
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; pushl %[number]; int $0x30; "      \
+             "addl $20, %%esp"                                  \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "r" (ARG0),                             \
+                 [arg1] "r" (ARG1),                             \
+                 [arg2] "r" (ARG2),                             \
+                 [arg3] "r" (ARG3)                              \
+               : "memory");                                     \
+          retval;                                               \
+        })
+
 int
 practice (int i)
 {
@@ -81,6 +100,94 @@ exit (int status)
   NOT_REACHED ();
 }
 
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+void
+memstat (struct memstat *ms)
+{
+  syscall1 (SYS_MEMSTAT, ms);
+}
+
+int
+dup2 (int old_fd, int new_fd)
+{
+  return syscall2 (SYS_DUP2, old_fd, new_fd);
+}
+
+int
+readv (int fd, const struct iovec *iov, int cnt)
+{
+  return syscall3 (SYS_READV, fd, iov, cnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int cnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, cnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+bool
+ring_setup (struct syscall_ring *ring)
+{
+  return syscall1 (SYS_RING_SETUP, ring);
+}
+
+int
+ring_enter (void)
+{
+  return syscall0 (SYS_RING_ENTER);
+}
+
+/* Queues system call NR with the given arguments on RING, to be
+   run by the next ring_enter().  Returns false if RING's request
+   queue is full. */
+bool
+ring_submit (struct syscall_ring *ring, uint32_t nr, uint32_t user_data,
+             uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+  struct ring_sqe *sqe;
+
+  if (ring->sq_tail - ring->sq_head >= RING_ENTRIES)
+    return false;
+  sqe = &ring->sq[ring->sq_tail % RING_ENTRIES];
+  sqe->nr = nr;
+  sqe->args[0] = arg0;
+  sqe->args[1] = arg1;
+  sqe->args[2] = arg2;
+  sqe->args[3] = arg3;
+  sqe->user_data = user_data;
+  ring->sq_tail++;
+  return true;
+}
+
+/* Takes the oldest completion from RING into *CQE.  Returns false
+   if there is none. */
+bool
+ring_reap (struct syscall_ring *ring, struct ring_cqe *cqe)
+{
+  if (ring->cq_head == ring->cq_tail)
+    return false;
+  *cqe = ring->cq[ring->cq_head % RING_ENTRIES];
+  ring->cq_head++;
+  return true;
+}
+
 pid_t
 exec (const char *file)
 {
@@ -93,6 +200,12 @@ wait (pid_t pid)
   return syscall1 (SYS_WAIT, pid);
 }
 
+pid_t
+wait_any (int *status)
+{
+  return (pid_t) syscall1 (SYS_WAIT_ANY, status);
+}
+
 bool
 create (const char *file, unsigned initial_size)
 {
@@ -3,6 +3,9 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <iovec.h>
+#include <memstat.h>
+#include <syscall-ring.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -24,6 +27,7 @@ void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 pid_t exec (const char *file);
 int wait (pid_t);
+pid_t wait_any (int *status);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
@@ -34,6 +38,19 @@ void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
 int practice (int i);
+pid_t fork (void);
+void memstat (struct memstat *);
+int dup2 (int old_fd, int new_fd);
+int readv (int fd, const struct iovec *, int cnt);
+int writev (int fd, const struct iovec *, int cnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+bool ring_setup (struct syscall_ring *);
+int ring_enter (void);
+bool ring_submit (struct syscall_ring *, uint32_t nr, uint32_t user_data,
+                  uint32_t arg0, uint32_t arg1, uint32_t arg2,
+                  uint32_t arg3);
+bool ring_reap (struct syscall_ring *, struct ring_cqe *);
 
 /* Project 3 and optionally project 4. */
 mapid_t mmap (int fd, void *addr);
@@ -0,0 +1,156 @@
+/* Test program for searching and counting in lib/kernel/bitmap.c.
+
+   Checks bitmap_scan(), bitmap_count(), bitmap_contains() and
+   bitmap_set_multiple() against bit-at-a-time versions on random
+   bitmaps, then times bitmap_scan() on a bitmap the size of the
+   free map for a 32 MB disk that is mostly full, the case where
+   searching one bit at a time was slowest.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+#include "devices/timer.h"
+
+/* Maximum number of bits in a bitmap that we will check. */
+#define MAX_BITS 300
+
+/* Number of bits in the bitmap we time: one per sector of a
+   32 MB disk. */
+#define DISK_BITS 65536
+
+static bool ref_contains (const struct bitmap *, size_t start, size_t cnt,
+                          bool value);
+static size_t ref_scan (const struct bitmap *, size_t start, size_t cnt,
+                        bool value);
+static void verify (struct bitmap *);
+static void benchmark (void);
+
+/* Test the bitmap implementation. */
+void
+test (void) 
+{
+  static uint8_t buf[DISK_BITS / 8 + 64];
+  size_t bit_cnt;
+
+  printf ("testing various size bitmaps:");
+  for (bit_cnt = 0; bit_cnt < MAX_BITS; bit_cnt = bit_cnt * 4 / 3 + 1)
+    {
+      int repeat;
+
+      printf (" %zu", bit_cnt);
+      for (repeat = 0; repeat < 10; repeat++) 
+        {
+          struct bitmap *b = bitmap_create_in_buf (bit_cnt, buf, sizeof buf);
+          unsigned density = random_ulong () % 101;
+          size_t i;
+
+          /* Set each bit with probability DENSITY percent. */
+          for (i = 0; i < bit_cnt; i++)
+            bitmap_set (b, i, random_ulong () % 100 < density);
+          verify (b);
+        }
+    }
+  printf (" done\n");
+
+  benchmark ();
+  printf ("bitmap: PASS\n");
+}
+
+/* Checks B's search, count, and multiple-set functions against
+   one-bit-at-a-time versions, for random ranges. */
+static void
+verify (struct bitmap *b) 
+{
+  size_t bit_cnt = bitmap_size (b);
+  int i;
+
+  for (i = 0; i < 50; i++)
+    {
+      size_t start = random_ulong () % (bit_cnt + 1);
+      size_t cnt = random_ulong () % (bit_cnt - start + 1);
+      bool value = random_ulong () % 2;
+      size_t j, count;
+
+      count = 0;
+      for (j = 0; j < cnt; j++)
+        count += bitmap_test (b, start + j) == value;
+      ASSERT (bitmap_count (b, start, cnt, value) == count);
+      ASSERT (bitmap_contains (b, start, cnt, value)
+              == ref_contains (b, start, cnt, value));
+      ASSERT (bitmap_scan (b, start, cnt, value)
+              == ref_scan (b, start, cnt, value));
+      ASSERT (bitmap_scan (b, start, cnt + 1, value)
+              == ref_scan (b, start, cnt + 1, value));
+
+      bitmap_set_multiple (b, start, cnt, value);
+      for (j = 0; j < bit_cnt; j++)
+        if (j >= start && j < start + cnt)
+          ASSERT (bitmap_test (b, j) == value);
+      bitmap_set_multiple (b, start, cnt, !value);
+    }
+}
+
+/* Times searches for runs of free bits in a DISK_BITS-bit bitmap
+   that is 90% full, with the free bits in short runs spread over
+   the whole bitmap. */
+static void
+benchmark (void) 
+{
+  static uint8_t buf[DISK_BITS / 8 + 64];
+  struct bitmap *b = bitmap_create_in_buf (DISK_BITS, buf, sizeof buf);
+  size_t cnt;
+  size_t i;
+
+  for (i = 0; i < DISK_BITS; i += 10)
+    bitmap_set_multiple (b, i, 9, true);
+
+  for (cnt = 1; cnt <= 16; cnt *= 2)
+    {
+      uint64_t start = timer_read_tsc ();
+      size_t found = bitmap_scan (b, 0, cnt, false);
+      uint64_t cycles = timer_read_tsc () - start;
+
+      ASSERT (found == ref_scan (b, 0, cnt, false));
+      printf ("scan for %2zu free bits of %d: %"PRIu64" cycles\n",
+              cnt, DISK_BITS, cycles);
+    }
+}
+
+/* Returns true if any of the CNT bits in B starting at START are
+   set to VALUE, testing one bit at a time. */
+static bool
+ref_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    if (bitmap_test (b, start + i) == value)
+      return true;
+  return false;
+}
+
+/* Returns the start of the first run of CNT bits set to VALUE in
+   B at or after START, testing one bit at a time, or
+   BITMAP_ERROR if there is none. */
+static size_t
+ref_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  if (cnt <= bitmap_size (b)) 
+    {
+      size_t last = bitmap_size (b) - cnt;
+      size_t i;
+
+      for (i = start; i <= last; i++)
+        if (!ref_contains (b, i, cnt, !value))
+          return i; 
+    }
+  return BITMAP_ERROR;
+}
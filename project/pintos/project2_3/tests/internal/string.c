@@ -0,0 +1,161 @@
+/* Test program for the block functions in lib/string.c.
+
+   Checks memcpy(), memset(), memcmp(), memchr() and strlen()
+   against byte-at-a-time versions for every combination of
+   source and destination alignment, then reports how many bytes
+   per cycle memcpy() and a byte-at-a-time copy move for 16-byte,
+   512-byte (one disk sector) and 4 kB (one page) blocks.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+#include "devices/timer.h"
+
+/* Largest block that we will check. */
+#define MAX_SIZE 80
+
+/* Times each block is copied in the benchmark. */
+#define ITERATIONS 1000
+
+static void verify (size_t dst_ofs, size_t src_ofs, size_t size);
+static void benchmark (size_t size);
+static void ref_memcpy (void *, const void *, size_t);
+
+/* Test the string functions. */
+void
+test (void)
+{
+  size_t size;
+
+  printf ("testing various size blocks:");
+  for (size = 0; size < MAX_SIZE; size++)
+    {
+      size_t dst_ofs, src_ofs;
+
+      printf (" %zu", size);
+      for (dst_ofs = 0; dst_ofs < 4; dst_ofs++)
+        for (src_ofs = 0; src_ofs < 4; src_ofs++)
+          verify (dst_ofs, src_ofs, size);
+    }
+  printf (" done\n");
+
+  benchmark (16);
+  benchmark (512);
+  benchmark (4096);
+  printf ("string: PASS\n");
+}
+
+/* Returns the sign of X: -1, 0, or 1. */
+static int
+sign (int x)
+{
+  return x < 0 ? -1 : x > 0;
+}
+
+/* Checks the string functions on SIZE-byte blocks at offsets
+   DST_OFS and SRC_OFS from word boundaries. */
+static void
+verify (size_t dst_ofs, size_t src_ofs, size_t size)
+{
+  static uint8_t src[MAX_SIZE + 8], dst[MAX_SIZE + 8], ref[MAX_SIZE + 8];
+  size_t i;
+
+  /* memcpy() copies exactly SIZE bytes. */
+  for (i = 0; i < sizeof src; i++)
+    {
+      src[i] = random_ulong () % 3 + 1;
+      dst[i] = ref[i] = 0;
+    }
+  memcpy (dst + dst_ofs, src + src_ofs, size);
+  ref_memcpy (ref + dst_ofs, src + src_ofs, size);
+  for (i = 0; i < sizeof dst; i++)
+    ASSERT (dst[i] == ref[i]);
+
+  /* memcmp() finds the first difference, or none. */
+  ASSERT (memcmp (dst + dst_ofs, src + src_ofs, size) == 0);
+  if (size > 0)
+    {
+      size_t ofs = random_ulong () % size;
+      dst[dst_ofs + ofs] = random_ulong () % 5;
+      ASSERT (sign (memcmp (dst + dst_ofs, src + src_ofs, size))
+              == sign (dst[dst_ofs + ofs] - src[src_ofs + ofs]));
+    }
+
+  /* memchr() finds the first occurrence, or none. */
+  for (i = 0; i < 4; i++)
+    {
+      const uint8_t *p;
+
+      for (p = src + src_ofs; p < src + src_ofs + size; p++)
+        if (*p == i)
+          break;
+      if (p == src + src_ofs + size)
+        p = NULL;
+      ASSERT (memchr (src + src_ofs, i, size) == p);
+    }
+
+  /* strlen() stops at the null terminator. */
+  src[src_ofs + size] = '\0';
+  ASSERT (strlen ((char *) src + src_ofs) == size);
+
+  /* memset() sets exactly SIZE bytes. */
+  memset (dst, 0x5a, sizeof dst);
+  memset (dst + dst_ofs, 0xa5, size);
+  for (i = 0; i < sizeof dst; i++)
+    ASSERT (dst[i] == (i >= dst_ofs && i < dst_ofs + size ? 0xa5 : 0x5a));
+}
+
+/* Prints BYTES / CYCLES to two decimal places. */
+static void
+print_rate (const char *name, size_t bytes, uint64_t cycles)
+{
+  uint64_t rate = cycles > 0 ? bytes * (uint64_t) 100 / cycles : 0;
+  printf (" %s %"PRIu64".%02"PRIu64" bytes/cycle",
+          name, rate / 100, rate % 100);
+}
+
+/* Times copies of SIZE-byte blocks with memcpy() and a byte at a
+   time, and prints both rates. */
+static void
+benchmark (size_t size)
+{
+  static uint8_t src[4096], dst[4096];
+  uint64_t start, fast, slow;
+  int i;
+
+  ASSERT (size <= sizeof src);
+
+  start = timer_read_tsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    memcpy (dst, src, size);
+  fast = timer_read_tsc () - start;
+
+  start = timer_read_tsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    ref_memcpy (dst, src, size);
+  slow = timer_read_tsc () - start;
+
+  printf ("copy %4zu bytes:", size);
+  print_rate ("memcpy", size * ITERATIONS, fast);
+  print_rate ("bytewise", size * ITERATIONS, slow);
+  printf ("\n");
+}
+
+/* Copies SIZE bytes from SRC to DST a byte at a time. */
+static void
+ref_memcpy (void *dst_, const void *src_, size_t size)
+{
+  volatile uint8_t *dst = dst_;
+  const uint8_t *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+}
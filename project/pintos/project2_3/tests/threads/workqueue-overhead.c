@@ -0,0 +1,99 @@
+/* Measures the cost of running a trivial task on a work queue,
+   compared with creating a kernel thread for it.
+
+   Runs TASK_CNT tasks that do nothing but record that they ran,
+   three ways: one new thread per task, waiting for each in turn;
+   one task at a time on a work queue with a single worker; and
+   all of them submitted at once to a work queue with WORKER_CNT
+   workers, then waited for together.  Prints the average number
+   of CPU cycles per task for each.
+
+   This is a benchmark, not a pass/fail test: the numbers it
+   prints depend on the host, and it is not part of "make check".
+   Run it with "pintos -- -q run workqueue-overhead". */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+#define TASK_CNT 64
+#define WORKER_CNT 4
+
+static struct workqueue serial_wq, parallel_wq;
+static struct work works[TASK_CNT];
+static struct semaphore thread_done;
+static volatile int run_cnt;
+
+static void task (void *aux);
+static void thread_task (void *aux);
+
+void
+test_workqueue_overhead (void) 
+{
+  uint64_t start;
+  int i;
+
+  sema_init (&thread_done, 0);
+  if (!workqueue_init (&serial_wq, "serial", 1, PRI_DEFAULT)
+      || !workqueue_init (&parallel_wq, "parallel", WORKER_CNT, PRI_DEFAULT))
+    fail ("could not start work queue threads");
+
+  /* One thread per task. */
+  run_cnt = 0;
+  start = timer_read_tsc ();
+  for (i = 0; i < TASK_CNT; i++)
+    {
+      if (thread_create ("task", PRI_DEFAULT, thread_task, NULL) == TID_ERROR)
+        fail ("thread_create failed");
+      sema_down (&thread_done);
+    }
+  msg ("thread_create: %"PRIu64" cycles per task.",
+       (timer_read_tsc () - start) / TASK_CNT);
+
+  /* One task at a time on a work queue. */
+  start = timer_read_tsc ();
+  for (i = 0; i < TASK_CNT; i++)
+    {
+      work_init (&works[i], task, NULL);
+      workqueue_submit (&serial_wq, &works[i]);
+      work_wait (&works[i]);
+    }
+  msg ("work queue, one at a time: %"PRIu64" cycles per task.",
+       (timer_read_tsc () - start) / TASK_CNT);
+
+  /* All tasks at once on a work queue. */
+  start = timer_read_tsc ();
+  for (i = 0; i < TASK_CNT; i++)
+    {
+      work_init (&works[i], task, NULL);
+      workqueue_submit (&parallel_wq, &works[i]);
+    }
+  for (i = 0; i < TASK_CNT; i++)
+    work_wait (&works[i]);
+  msg ("work queue, batched: %"PRIu64" cycles per task.",
+       (timer_read_tsc () - start) / TASK_CNT);
+
+  if (run_cnt != 3 * TASK_CNT)
+    fail ("%d tasks ran, expected %d", run_cnt, 3 * TASK_CNT);
+}
+
+static void
+task (void *aux UNUSED) 
+{
+  enum intr_level old_level = intr_disable ();
+  run_cnt++;
+  intr_set_level (old_level);
+}
+
+static void
+thread_task (void *aux UNUSED) 
+{
+  task (NULL);
+  sema_up (&thread_done);
+}
@@ -0,0 +1,34 @@
+/* Duplicates a descriptor onto a number far past those in use,
+   checks that both share a file position and that the original
+   can be closed without affecting the copy, then checks that
+   open() hands back the lowest free descriptor.  Does the same
+   for a directory, and exits with one still open. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[10], name[READDIR_MAX_LEN + 1];
+  int fd, dup, dir;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((dup = dup2 (fd, 1000)) == 1000, "dup2 onto fd 1000");
+  CHECK (read (fd, buf, sizeof buf) == sizeof buf, "read through original");
+  CHECK (tell (dup) == sizeof buf, "copy shares position");
+  close (fd);
+  CHECK (read (dup, buf, sizeof buf) == sizeof buf, "read through copy");
+  CHECK (open ("sample.txt") == fd, "open reuses lowest free fd");
+  CHECK (dup2 (dup, dup) == dup, "dup2 onto itself");
+  CHECK (dup2 (12345, 3) == -1, "dup2 from bad fd");
+
+  CHECK ((dir = open ("/")) > 1, "open \"/\"");
+  CHECK (dup2 (dir, 500) == 500, "dup2 directory onto fd 500");
+  close (dir);
+  CHECK (isdir (500), "copy is a directory");
+  CHECK (readdir (500, name), "readdir through copy");
+  close (500);
+  CHECK (open ("/") > 1, "open \"/\" and leave it open");
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dup2) begin
+(dup2) open "sample.txt"
+(dup2) dup2 onto fd 1000
+(dup2) read through original
+(dup2) copy shares position
+(dup2) read through copy
+(dup2) open reuses lowest free fd
+(dup2) dup2 onto itself
+(dup2) dup2 from bad fd
+(dup2) open "/"
+(dup2) dup2 directory onto fd 500
+(dup2) copy is a directory
+(dup2) readdir through copy
+(dup2) open "/" and leave it open
+(dup2) end
+dup2: exit(0)
+EOF
+pass;
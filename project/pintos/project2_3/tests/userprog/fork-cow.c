@@ -0,0 +1,28 @@
+/* Forks a child that writes to a global and to a stack
+   variable, then checks that the parent still sees its own
+   values of both once the child has exited. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int global = 1;
+
+void
+test_main (void) 
+{
+  int local = 2;
+  pid_t pid = fork ();
+
+  if (pid == 0)
+    {
+      global = 10;
+      local = 20;
+      exit (global + local);
+    }
+  if (pid == PID_ERROR)
+    fail ("fork() failed");
+
+  CHECK (wait (pid) == 30, "wait for child");
+  CHECK (global == 1 && local == 2, "parent's memory unchanged");
+}
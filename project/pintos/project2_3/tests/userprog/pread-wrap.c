@@ -0,0 +1,19 @@
+/* Passes pread() a valid buffer with a length that makes the
+   buffer's end wrap around past the top of the address space.
+   The process must be terminated with -1 exit code. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[16];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  pread (handle, buf, (unsigned) (0x1000 - (uintptr_t) buf), 0);
+  fail ("should not have survived pread()");
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-wrap) begin
+(pread-wrap) open "sample.txt"
+pread-wrap: exit(-1)
+EOF
+pass;
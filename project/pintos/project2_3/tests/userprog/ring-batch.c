@@ -0,0 +1,41 @@
+/* Queues a batch of writes, a disallowed exit(), and a tell() on
+   a system call ring, runs them all with one ring_enter(), and
+   checks each completion. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define WRITE_CNT 10
+
+static struct syscall_ring ring;
+
+void
+test_main (void) 
+{
+  static const char data[] = "0123456789";
+  struct ring_cqe cqe;
+  int fd, i;
+
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (ring_setup (&ring), "ring_setup");
+
+  for (i = 0; i < WRITE_CNT; i++)
+    ring_submit (&ring, SYS_WRITE, i, fd, (uint32_t) data, sizeof data - 1, 0);
+  ring_submit (&ring, SYS_EXIT, WRITE_CNT, 1, 0, 0, 0);
+  ring_submit (&ring, SYS_TELL, WRITE_CNT + 1, fd, 0, 0, 0);
+  CHECK (ring_enter () == WRITE_CNT + 2, "run %d queued calls", WRITE_CNT + 2);
+
+  for (i = 0; i < WRITE_CNT; i++)
+    if (!ring_reap (&ring, &cqe) || cqe.user_data != (uint32_t) i
+        || cqe.result != sizeof data - 1)
+      fail ("write %d did not complete", i);
+  msg ("writes completed");
+  CHECK (ring_reap (&ring, &cqe) && cqe.result == -1, "exit refused");
+  CHECK (ring_reap (&ring, &cqe) && cqe.result == WRITE_CNT * (sizeof data - 1),
+         "tell after writes");
+  CHECK (!ring_reap (&ring, &cqe), "no more completions");
+  CHECK (filesize (fd) == WRITE_CNT * (sizeof data - 1), "file size");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-batch) begin
+(ring-batch) create "data"
+(ring-batch) open "data"
+(ring-batch) ring_setup
+(ring-batch) run 12 queued calls
+(ring-batch) writes completed
+(ring-batch) exit refused
+(ring-batch) tell after writes
+(ring-batch) no more completions
+(ring-batch) file size
+(ring-batch) end
+ring-batch: exit(0)
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Writes a header and a payload with one writev(), reads them
+   back with pread() and readv(), and overwrites part of the
+   header with pwrite(), checking that the positional calls leave
+   the file position alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char header[] = "HDR1";
+static char payload[600];
+static char buf[sizeof payload];
+
+void
+test_main (void) 
+{
+  struct iovec iov[2];
+  char head[sizeof header];
+  size_t i;
+  int fd;
+
+  for (i = 0; i < sizeof payload; i++)
+    payload[i] = 'a' + i % 26;
+
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+
+  iov[0].iov_base = header;
+  iov[0].iov_len = sizeof header;
+  iov[1].iov_base = payload;
+  iov[1].iov_len = sizeof payload;
+  CHECK (writev (fd, iov, 2) == sizeof header + sizeof payload,
+         "writev header and payload");
+  CHECK (tell (fd) == sizeof header + sizeof payload, "position after writev");
+
+  CHECK (pread (fd, buf, sizeof buf, sizeof header) == sizeof buf,
+         "pread payload");
+  CHECK (!memcmp (buf, payload, sizeof payload), "payload matches");
+  CHECK (pwrite (fd, "X", 1, 0) == 1, "pwrite into header");
+  CHECK (tell (fd) == sizeof header + sizeof payload,
+         "position unchanged by pread and pwrite");
+
+  seek (fd, 0);
+  iov[0].iov_base = head;
+  iov[1].iov_base = buf;
+  CHECK (readv (fd, iov, 2) == sizeof header + sizeof payload,
+         "readv header and payload");
+  CHECK (head[0] == 'X' && !memcmp (head + 1, header + 1, sizeof header - 1),
+         "header matches");
+  CHECK (!memcmp (buf, payload, sizeof payload), "payload matches");
+  close (fd);
+}
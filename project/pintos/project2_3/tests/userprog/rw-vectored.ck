@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rw-vectored) begin
+(rw-vectored) create "data"
+(rw-vectored) open "data"
+(rw-vectored) writev header and payload
+(rw-vectored) position after writev
+(rw-vectored) pread payload
+(rw-vectored) payload matches
+(rw-vectored) pwrite into header
+(rw-vectored) position unchanged by pread and pwrite
+(rw-vectored) readv header and payload
+(rw-vectored) header matches
+(rw-vectored) payload matches
+(rw-vectored) end
+rw-vectored: exit(0)
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Starts two subprocesses, then reaps both with wait_any(),
+   which must return each of them exactly once with its exit
+   code.  A further wait_any() must return -1 immediately, and
+   so must wait() on a child that wait_any() already reaped. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t children[2];
+  bool reaped[2] = {false, false};
+  int i, status;
+
+  /* Nothing is printed until both children are gone, since
+     their output would interleave with ours. */
+  for (i = 0; i < 2; i++)
+    if ((children[i] = exec ("child-simple")) == PID_ERROR)
+      fail ("exec failed");
+
+  for (i = 0; i < 2; i++)
+    {
+      pid_t pid = wait_any (&status);
+      int j;
+
+      for (j = 0; j < 2; j++)
+        if (pid == children[j] && !reaped[j])
+          break;
+      if (j == 2)
+        fail ("wait_any() returned unexpected pid %d", pid);
+      if (status != 81)
+        fail ("wait_any() returned status %d", status);
+      reaped[j] = true;
+    }
+  msg ("reaped both children");
+
+  msg ("wait_any() = %d", wait_any (&status));
+  msg ("wait(child) = %d", wait (children[0]));
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(wait-any) begin
+(child-simple) run
+child-simple: exit(81)
+(child-simple) run
+child-simple: exit(81)
+(wait-any) reaped both children
+(wait-any) wait_any() = -1
+(wait-any) wait(child) = -1
+(wait-any) end
+wait-any: exit(0)
+EOF
+(wait-any) begin
+(child-simple) run
+(child-simple) run
+child-simple: exit(81)
+child-simple: exit(81)
+(wait-any) reaped both children
+(wait-any) wait_any() = -1
+(wait-any) wait(child) = -1
+(wait-any) end
+wait-any: exit(0)
+EOF
+pass;
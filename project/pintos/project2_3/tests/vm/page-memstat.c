@@ -0,0 +1,33 @@
+/* Dirties every page of a buffer and checks that the faults
+   and the resident pages show up in memstat(). */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 64
+
+/* One spare page, so that no page we touch can share its frame
+   with initialized data. */
+static char buf[(PAGE_CNT + 1) * 4096];
+
+void
+test_main (void)
+{
+  char *pages = (char *) (((uintptr_t) buf + 4095) & ~(uintptr_t) 4095);
+  struct memstat before, after;
+  size_t i;
+
+  memstat (&before);
+  for (i = 0; i < PAGE_CNT; i++)
+    pages[i * 4096] = i;
+  memstat (&after);
+
+  CHECK (after.page_faults - before.page_faults >= PAGE_CNT,
+         "memstat counts a fault per dirtied page");
+  CHECK (after.rss >= PAGE_CNT, "memstat counts the pages as resident");
+  CHECK (after.pages_in >= before.pages_in
+         && after.pages_out >= before.pages_out,
+         "swap counters never go backward");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(page-memstat) begin
+(page-memstat) memstat counts a fault per dirtied page
+(page-memstat) memstat counts the pages as resident
+(page-memstat) swap counters never go backward
+(page-memstat) end
+EOF
+pass;
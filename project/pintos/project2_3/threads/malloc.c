@@ -6,27 +6,41 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
    The size of each request, in bytes, is rounded up to a power
    of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   that size.  A table indexed by the rounded-up size finds the
+   descriptor in constant time.
+
+   Memory for blocks comes from pages, called "arenas", obtained
+   from the page allocator (if none is available, malloc()
+   returns a null pointer).  Each arena is divided into blocks
+   and keeps a singly linked list of its own free blocks.  A
+   descriptor keeps a list of its arenas that have both free and
+   used blocks.  It takes blocks from the arena at the front of
+   that list, and arenas that have just had a block freed go to
+   the front, so that allocations fill up pages that are already
+   in use before touching new or nearly empty ones.  When an
+   arena has no in-use blocks, it is given back to the page
+   allocator, except that each descriptor keeps one such arena
+   as a spare.
+
+   Taking a descriptor's lock for every malloc() and free() would
+   be costly, so each thread also has a small "magazine" of free
+   blocks for each descriptor.  malloc() takes a block from the
+   running thread's magazine, and free() puts one back into it,
+   without locking, since no other thread touches the magazine.
+   When a magazine is empty, it is refilled with a batch of
+   blocks, and when it is full, a batch of blocks is given back
+   to their arenas, both under the descriptor's lock.  A thread's
+   magazines are emptied when it exits.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
@@ -39,7 +53,9 @@ struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
-    struct list free_list;      /* List of free blocks. */
+    size_t mag_size;            /* Most blocks in a thread's magazine. */
+    struct list partial;        /* Arenas with free and used blocks. */
+    struct arena *spare;        /* Arena with no used blocks, or null. */
     struct lock lock;           /* Lock. */
   };
 
@@ -52,26 +68,38 @@ struct arena
     unsigned magic;             /* Always set to ARENA_MAGIC. */
     struct desc *desc;          /* Owning descriptor, null for big block. */
     size_t free_cnt;            /* Free blocks; pages in big block. */
+    struct block *free;         /* Free blocks in this arena. */
+    struct list_elem elem;      /* Element in descriptor's PARTIAL. */
   };
 
 /* Free block. */
 struct block 
   {
-    struct list_elem free_elem; /* Free list element. */
+    struct block *next;         /* Next free block. */
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[MALLOC_CLASS_CNT]; /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Maps (SIZE + SIZE_GRAIN - 1) / SIZE_GRAIN, for a SIZE no bigger
+   than the largest descriptor's blocks, to the index of the
+   smallest descriptor that satisfies a SIZE-byte request. */
+#define SIZE_GRAIN 16
+#define MAX_BLOCK_SIZE (SIZE_GRAIN << (MALLOC_CLASS_CNT - 1))
+static uint8_t size_to_desc[MAX_BLOCK_SIZE / SIZE_GRAIN + 1];
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static bool refill (struct desc *, struct malloc_magazine *);
+static void drain (struct desc *, struct malloc_magazine *, size_t cnt);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) 
 {
   size_t block_size;
+  size_t i;
 
   for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
     {
@@ -79,9 +107,25 @@ malloc_init (void)
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
+      d->mag_size = d->blocks_per_arena / 2;
+      if (d->mag_size > 16)
+        d->mag_size = 16;
+      else if (d->mag_size < 2)
+        d->mag_size = 2;
+      list_init (&d->partial);
+      d->spare = NULL;
       lock_init (&d->lock);
     }
+  ASSERT (desc_cnt == MALLOC_CLASS_CNT);
+  ASSERT (descs[desc_cnt - 1].block_size == MAX_BLOCK_SIZE);
+
+  for (i = 0; i < sizeof size_to_desc; i++)
+    {
+      size_t d = 0;
+      while (descs[d].block_size < i * SIZE_GRAIN)
+        d++;
+      size_to_desc[i] = d;
+    }
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -89,6 +133,7 @@ malloc_init (void)
 void *
 malloc (size_t size) 
 {
+  struct malloc_magazine *m;
   struct desc *d;
   struct block *b;
   struct arena *a;
@@ -97,12 +142,7 @@ malloc (size_t size)
   if (size == 0)
     return NULL;
 
-  /* Find the smallest descriptor that satisfies a SIZE-byte
-     request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) 
+  if (size > MAX_BLOCK_SIZE) 
     {
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
@@ -119,37 +159,20 @@ malloc (size_t size)
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
-    {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
+  /* Find the smallest descriptor that satisfies a SIZE-byte
+     request, and the running thread's magazine for it. */
+  ASSERT (!intr_context ());
+  d = &descs[size_to_desc[DIV_ROUND_UP (size, SIZE_GRAIN)]];
+  m = &thread_current ()->magazines[d - descs];
 
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
-    }
+  /* If the magazine is empty, refill it. */
+  if (m->cnt == 0 && !refill (d, m))
+    return NULL;
 
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
+  /* Take a block from the magazine and return it. */
+  b = m->blocks;
+  m->blocks = b->next;
+  m->cnt--;
   return b;
 }
 
@@ -227,42 +250,151 @@ free (void *p)
       if (d != NULL) 
         {
           /* It's a normal block.  We handle it here. */
+          struct malloc_magazine *m;
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
+          /* Put the block into the running thread's magazine,
+             first making room if it is full. */
+          ASSERT (!intr_context ());
+          m = &thread_current ()->magazines[d - descs];
+          if (m->cnt >= d->mag_size)
+            drain (d, m, d->mag_size / 2);
+          b->next = m->blocks;
+          m->blocks = b;
+          m->cnt++;
+        }
+      else
+        {
+          /* It's a big block.  Free its pages. */
+          palloc_free_multiple (a, a->free_cnt);
+          return;
+        }
+    }
+}
+
+/* Gives back the blocks in the running thread's magazines.
+   Called by thread_exit(). */
+void
+malloc_thread_exit (void) 
+{
+  struct thread *t = thread_current ();
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    if (t->magazines[i].cnt > 0)
+      drain (&descs[i], &t->magazines[i], t->magazines[i].cnt);
+}
+
+/* Puts half of D's magazine size worth of free blocks into
+   magazine M, which must be empty.  Returns true if successful,
+   false if memory is not available. */
+static bool
+refill (struct desc *d, struct malloc_magazine *m) 
+{
+  size_t want = d->mag_size / 2;
+
+  ASSERT (m->cnt == 0);
+
+  lock_acquire (&d->lock);
+  while (m->cnt < want)
+    {
+      struct arena *a;
+      struct block *b;
 
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+      /* If no arena has free blocks, use the spare arena or a
+         new one. */
+      if (list_empty (&d->partial))
+        {
+          a = d->spare;
+          d->spare = NULL;
+          if (a == NULL)
             {
               size_t i;
 
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
+              /* Allocate a page, taking back the object caches'
+                 spare pages if need be. */
+              a = palloc_get_page (0);
+              if (a == NULL && slab_reclaim () > 0)
+                a = palloc_get_page (0);
+              if (a == NULL)
+                break;
+
+              /* Initialize arena and chain its blocks together. */
+              a->magic = ARENA_MAGIC;
+              a->desc = d;
+              a->free_cnt = d->blocks_per_arena;
+              a->free = NULL;
+              for (i = d->blocks_per_arena; i-- > 0; )
                 {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
+                  b = arena_to_block (a, i);
+                  b->next = a->free;
+                  a->free = b;
                 }
-              palloc_free_page (a);
             }
+          list_push_back (&d->partial, &a->elem);
+        }
 
-          lock_release (&d->lock);
+      /* Move blocks from the front arena to the magazine. */
+      a = list_entry (list_front (&d->partial), struct arena, elem);
+      while (m->cnt < want && a->free != NULL)
+        {
+          b = a->free;
+          a->free = b->next;
+          a->free_cnt--;
+          b->next = m->blocks;
+          m->blocks = b;
+          m->cnt++;
         }
-      else
+      if (a->free == NULL)
+        list_remove (&a->elem);
+    }
+  lock_release (&d->lock);
+
+  return m->cnt > 0;
+}
+
+/* Gives CNT blocks from magazine M back to their arenas in D. */
+static void
+drain (struct desc *d, struct malloc_magazine *m, size_t cnt) 
+{
+  ASSERT (cnt <= m->cnt);
+
+  lock_acquire (&d->lock);
+  for (; cnt > 0; cnt--)
+    {
+      struct block *b = m->blocks;
+      struct arena *a = block_to_arena (b);
+
+      m->blocks = b->next;
+      m->cnt--;
+
+      /* Add block to its arena's free list.  An arena that was
+         full goes to the front of the partial list, so that it is
+         the next to be filled up again. */
+      b->next = a->free;
+      a->free = b;
+      if (a->free_cnt++ == 0)
+        list_push_front (&d->partial, &a->elem);
+
+      /* If the arena is now entirely unused, keep it as the spare
+         or free it. */
+      if (a->free_cnt >= d->blocks_per_arena) 
         {
-          /* It's a big block.  Free its pages. */
-          palloc_free_multiple (a, a->free_cnt);
-          return;
+          ASSERT (a->free_cnt == d->blocks_per_arena);
+          list_remove (&a->elem);
+          if (d->spare == NULL)
+            d->spare = a;
+          else
+            palloc_free_page (a);
         }
     }
+  lock_release (&d->lock);
 }
-
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
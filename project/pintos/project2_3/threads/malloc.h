@@ -4,10 +4,21 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* Number of malloc() size classes: 16, 32, ..., 1024 bytes. */
+#define MALLOC_CLASS_CNT 7
+
+/* A thread's cache of free blocks of one size class. */
+struct malloc_magazine
+  {
+    void *blocks;               /* Free blocks, singly linked. */
+    size_t cnt;                 /* Number of blocks. */
+  };
+
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+void malloc_thread_exit (void);
 
 #endif /* threads/malloc.h */
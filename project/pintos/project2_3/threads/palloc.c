@@ -2,13 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -25,12 +26,49 @@
    half to the user pool.  That should be huge overkill for the
    kernel pool, but that's just fine for demonstration purposes. */
 
-/* A memory pool. */
+/* A memory pool.
+
+   Free pages are managed with a binary buddy system.  Every free
+   page belongs to exactly one free "block" of 2**K pages, for
+   some "order" K, whose first page index within the pool is a
+   multiple of 2**K.  The blocks of each order are kept on a free
+   list, threaded through the first page of each block, and bit K
+   of FREE_MASK is set when that list is nonempty.  A request for
+   N pages takes a block of the smallest order that is at least N
+   pages, splitting a larger block if need be, and gives back the
+   pages past the first N.  A freed block is merged with its
+   "buddy", the other half of the block of the next larger order,
+   for as long as the buddy is free too.
+
+   The pool's lists and maps are only touched with interrupts
+   off, because pages are freed from thread_schedule_tail(),
+   where sleeping on a lock is not allowed.  Every operation
+   takes O(log n) steps, so interrupts are not off for long. */
+#define MAX_ORDER 16                    /* Largest block: 2**16 pages. */
+
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *orders;                    /* Per page: order + 1 of the free
+                                           block it starts, or 0. */
+    struct list free_lists[MAX_ORDER + 1]; /* Free blocks, by order. */
+    unsigned free_mask;                 /* Orders with nonempty lists. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+    const char *name;                   /* Name, for statistics. */
+
+    /* Statistics. */
+    size_t used_cnt;                    /* Pages allocated. */
+    size_t peak_used_cnt;               /* Largest value of USED_CNT. */
+    unsigned long long alloc_cnt;       /* Successful allocations. */
+    unsigned long long fail_cnt;        /* Failed allocations. */
+    unsigned long long free_cnt;        /* Calls to free. */
+  };
+
+/* Header of a free block, stored in its first page. */
+struct free_block
+  {
+    struct list_elem elem;              /* Element in free list. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +77,9 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t take_block (struct pool *, int order);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void print_pool_stats (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -71,15 +112,35 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void *pages;
   size_t page_idx;
+  int order;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  /* Smallest order whose blocks hold PAGE_CNT pages. */
+  for (order = 0; order <= MAX_ORDER && ((size_t) 1 << order) < page_cnt;
+       order++)
+    continue;
+
+  old_level = intr_disable ();
+  page_idx = order <= MAX_ORDER ? take_block (pool, order) : BITMAP_ERROR;
+  if (page_idx != BITMAP_ERROR)
+    {
+      /* Give back the part of the block we do not need. */
+      free_range (pool, page_idx + page_cnt,
+                  ((size_t) 1 << order) - page_cnt);
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+      pool->alloc_cnt++;
+      pool->used_cnt += page_cnt;
+      if (pool->used_cnt > pool->peak_used_cnt)
+        pool->peak_used_cnt = pool->used_cnt;
+    }
+  else
+    pool->fail_cnt++;
+  intr_set_level (old_level);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -118,6 +179,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -137,8 +199,13 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  free_range (pool, page_idx, page_cnt);
+  pool->free_cnt++;
+  pool->used_cnt -= page_cnt;
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,15 +215,27 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Prints allocation and fragmentation statistics for both
+   pools. */
+void
+palloc_print_stats (void)
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map and order map at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -164,9 +243,19 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->orders = (uint8_t *) base + bm_size;
+  memset (p->orders, 0, page_cnt);
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init (&p->free_lists[order]);
+  p->free_mask = 0;
   p->base = base + bm_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  p->name = name;
+  p->used_cnt = p->peak_used_cnt = 0;
+  p->alloc_cnt = p->fail_cnt = p->free_cnt = 0;
+
+  free_range (p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +269,130 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Adds the free block of 2**ORDER pages at PAGE_IDX in POOL to
+   its free list. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order)
+{
+  struct free_block *fb = (struct free_block *) (pool->base
+                                                 + PGSIZE * page_idx);
+
+  list_push_front (&pool->free_lists[order], &fb->elem);
+  pool->orders[page_idx] = order + 1;
+  pool->free_mask |= 1u << order;
+}
+
+/* Removes the free block of 2**ORDER pages at PAGE_IDX in POOL
+   from its free list. */
+static void
+remove_block (struct pool *pool, size_t page_idx, int order)
+{
+  struct free_block *fb = (struct free_block *) (pool->base
+                                                 + PGSIZE * page_idx);
+
+  list_remove (&fb->elem);
+  pool->orders[page_idx] = 0;
+  if (list_empty (&pool->free_lists[order]))
+    pool->free_mask &= ~(1u << order);
+}
+
+/* Takes a free block of 2**ORDER pages from POOL, splitting the
+   smallest larger free block if there is none of that order, and
+   returns the index of its first page, or BITMAP_ERROR if there
+   is no block large enough. */
+static size_t
+take_block (struct pool *pool, int order)
+{
+  unsigned mask = pool->free_mask & ~((1u << order) - 1);
+  struct free_block *fb;
+  size_t page_idx;
+  int have;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (mask == 0)
+    return BITMAP_ERROR;
+  have = __builtin_ctz (mask);
+
+  fb = list_entry (list_front (&pool->free_lists[have]),
+                   struct free_block, elem);
+  page_idx = pg_no (fb) - pg_no (pool->base);
+  remove_block (pool, page_idx, have);
+
+  /* Split, handing the upper halves back. */
+  while (have > order)
+    {
+      have--;
+      push_block (pool, page_idx + ((size_t) 1 << have), have);
+    }
+  return page_idx;
+}
+
+/* Gives the PAGE_CNT pages starting at PAGE_IDX in POOL to the
+   buddy system, as the largest aligned blocks that fit, merging
+   each with its buddy for as long as the buddy is free. */
+static void
+free_range (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  size_t end = page_idx + page_cnt;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (page_idx < end)
+    {
+      size_t idx = page_idx;
+      int order = 0;
+
+      /* Largest block that starts at PAGE_IDX and fits. */
+      while (order < MAX_ORDER
+             && idx % ((size_t) 2 << order) == 0
+             && idx + ((size_t) 2 << order) <= end)
+        order++;
+      page_idx += (size_t) 1 << order;
+
+      /* Merge with free buddies. */
+      while (order < MAX_ORDER)
+        {
+          size_t buddy = idx ^ ((size_t) 1 << order);
+          if (buddy + ((size_t) 1 << order) > pool->page_cnt
+              || pool->orders[buddy] != order + 1)
+            break;
+          remove_block (pool, buddy, order);
+          if (buddy < idx)
+            idx = buddy;
+          order++;
+        }
+      push_block (pool, idx, order);
+    }
+}
+
+/* Prints POOL's statistics, including how its free pages are
+   split into blocks: the more free pages there are in small
+   blocks, the more fragmented the pool. */
+static void
+print_pool_stats (struct pool *pool)
+{
+  enum intr_level old_level;
+  size_t blocks[MAX_ORDER + 1];
+  int order, largest = -1;
+
+  old_level = intr_disable ();
+  for (order = 0; order <= MAX_ORDER; order++)
+    {
+      blocks[order] = list_size (&pool->free_lists[order]);
+      if (blocks[order] > 0)
+        largest = order;
+    }
+  intr_set_level (old_level);
+
+  printf ("%s: %zu of %zu pages in use (peak %zu), %llu allocs, "
+          "%llu frees, %llu failed\n",
+          pool->name, pool->used_cnt, pool->page_cnt, pool->peak_used_cnt,
+          pool->alloc_cnt, pool->free_cnt, pool->fail_cnt);
+  printf ("%s: largest free block %zu pages, free blocks by order:",
+          pool->name, largest >= 0 ? (size_t) 1 << largest : 0);
+  for (order = 0; order <= largest; order++)
+    printf (" %zu", blocks[order]);
+  printf ("\n");
+}
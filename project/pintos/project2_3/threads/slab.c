@@ -0,0 +1,307 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Object caches, after Bonwick's slab allocator.
+
+   malloc() rounds every request up to a power of 2, so a 540-byte
+   object takes a 1 kB block, and constructs nothing.  A slab cache
+   instead serves objects of one fixed size, packed back to back
+   in pages called "slabs".  Each slab starts with a header and
+   keeps its free objects on a list threaded through the objects
+   themselves.  Slabs are kept on one of three lists according
+   to how many of their objects are in use, so an allocation can
+   always take its object from the first partial slab.
+
+   If the cache has a constructor, each object is constructed
+   once, when its slab is set up, and freed objects keep their
+   constructed state.  The free-list link then lives just past
+   the end of the object rather than over its first bytes.
+
+   Each cache keeps at most one empty slab around for reuse, and
+   gives further empty slabs straight back to the page allocator.
+   slab_reclaim() gives back those last empty slabs too, and is
+   called when the kernel pool runs dry. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Alignment of objects within a slab. */
+#define SLAB_ALIGN 8
+
+/* A slab: the header at the start of each page owned by a
+   cache. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of the cache's lists. */
+    void *free;                 /* First free object, or null. */
+    size_t in_use;              /* Number of objects allocated. */
+  };
+
+/* Offset of the first object in a slab. */
+#define SLAB_OBJS_OFS ROUND_UP (sizeof (struct slab), SLAB_ALIGN)
+
+/* List of all caches. */
+static struct list caches = LIST_INITIALIZER (caches);
+
+static struct slab *slab_create (struct slab_cache *);
+static struct slab *obj_to_slab (struct slab_cache *, void *);
+
+/* Returns the free-list link stored in free object OBJ of
+   CACHE. */
+static inline void **
+obj_link (struct slab_cache *cache, void *obj)
+{
+  return (void **) ((uint8_t *) obj + cache->link_ofs);
+}
+
+/* Initializes CACHE to serve objects of SIZE bytes, constructed
+   with CTOR if it is nonnull.  NAME must remain valid for as
+   long as CACHE is in use.
+
+   Caches are never destroyed, so CACHE should have static
+   storage duration.  Initializing a cache does not allocate
+   memory, so it may be done before the page allocator is
+   set up. */
+void
+slab_cache_init (struct slab_cache *cache, const char *name, size_t size,
+                 slab_ctor *ctor)
+{
+  enum intr_level old_level;
+
+  ASSERT (cache != NULL);
+  ASSERT (name != NULL);
+  ASSERT (size > 0);
+
+  cache->name = name;
+  cache->obj_size = size;
+  cache->ctor = ctor;
+  if (ctor != NULL)
+    {
+      cache->link_ofs = ROUND_UP (size, sizeof (void *));
+      cache->obj_stride = ROUND_UP (cache->link_ofs + sizeof (void *),
+                                    SLAB_ALIGN);
+    }
+  else
+    {
+      cache->link_ofs = 0;
+      cache->obj_stride = ROUND_UP (size, SLAB_ALIGN);
+    }
+  cache->objs_per_slab = (PGSIZE - SLAB_OBJS_OFS) / cache->obj_stride;
+  ASSERT (cache->objs_per_slab > 0);
+
+  lock_init (&cache->lock);
+  list_init (&cache->partial);
+  list_init (&cache->full);
+  list_init (&cache->empty);
+
+  cache->slab_cnt = 0;
+  cache->in_use = cache->peak_in_use = 0;
+  cache->alloc_cnt = cache->free_cnt = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&caches, &cache->elem);
+  intr_set_level (old_level);
+}
+
+/* Obtains and returns an object from CACHE.  If CACHE has a
+   constructor, the object is in its constructed state.  Returns
+   a null pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *cache)
+{
+  struct slab *slab;
+  void *obj;
+
+  ASSERT (cache != NULL);
+
+  lock_acquire (&cache->lock);
+  cache->alloc_cnt++;
+
+  /* Take the first partial slab, or else an empty one. */
+  if (!list_empty (&cache->partial))
+    slab = list_entry (list_front (&cache->partial), struct slab, elem);
+  else if (!list_empty (&cache->empty))
+    {
+      slab = list_entry (list_pop_front (&cache->empty), struct slab, elem);
+      list_push_front (&cache->partial, &slab->elem);
+    }
+  else
+    {
+      slab = slab_create (cache);
+      if (slab == NULL)
+        {
+          /* Give back other caches' spare slabs and try once
+             more.  We must not hold our lock meanwhile, since
+             slab_reclaim() takes every cache's lock. */
+          lock_release (&cache->lock);
+          slab_reclaim ();
+          lock_acquire (&cache->lock);
+          slab = slab_create (cache);
+          if (slab == NULL)
+            {
+              lock_release (&cache->lock);
+              return NULL;
+            }
+        }
+      list_push_front (&cache->partial, &slab->elem);
+    }
+
+  /* Take the slab's first free object. */
+  obj = slab->free;
+  slab->free = *obj_link (cache, obj);
+  if (++slab->in_use == cache->objs_per_slab)
+    {
+      list_remove (&slab->elem);
+      list_push_back (&cache->full, &slab->elem);
+    }
+
+  if (++cache->in_use > cache->peak_in_use)
+    cache->peak_in_use = cache->in_use;
+  lock_release (&cache->lock);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from CACHE with
+   slab_alloc() and, if CACHE has a constructor, must be in its
+   constructed state, to CACHE.  A null OBJ is ignored. */
+void
+slab_free (struct slab_cache *cache, void *obj)
+{
+  struct slab *slab;
+  bool was_full;
+
+  ASSERT (cache != NULL);
+
+  if (obj == NULL)
+    return;
+
+  slab = obj_to_slab (cache, obj);
+
+  lock_acquire (&cache->lock);
+  cache->free_cnt++;
+  cache->in_use--;
+
+  was_full = slab->in_use == cache->objs_per_slab;
+  *obj_link (cache, obj) = slab->free;
+  slab->free = obj;
+  if (--slab->in_use == 0)
+    {
+      /* Keep one empty slab for reuse; give any other back. */
+      list_remove (&slab->elem);
+      if (list_empty (&cache->empty))
+        list_push_back (&cache->empty, &slab->elem);
+      else
+        {
+          cache->slab_cnt--;
+          palloc_free_page (slab);
+        }
+    }
+  else if (was_full)
+    {
+      list_remove (&slab->elem);
+      list_push_front (&cache->partial, &slab->elem);
+    }
+
+  lock_release (&cache->lock);
+}
+
+/* Gives every cache's empty slabs back to the page allocator.
+   Returns the number of pages freed. */
+size_t
+slab_reclaim (void)
+{
+  struct list_elem *e;
+  size_t page_cnt = 0;
+
+  for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+    {
+      struct slab_cache *cache = list_entry (e, struct slab_cache, elem);
+
+      lock_acquire (&cache->lock);
+      while (!list_empty (&cache->empty))
+        {
+          struct list_elem *se = list_pop_front (&cache->empty);
+          palloc_free_page (list_entry (se, struct slab, elem));
+          cache->slab_cnt--;
+          page_cnt++;
+        }
+      lock_release (&cache->lock);
+    }
+  return page_cnt;
+}
+
+/* Prints statistics for each cache. */
+void
+slab_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+    {
+      struct slab_cache *cache = list_entry (e, struct slab_cache, elem);
+
+      printf ("Slab %s: %zu-byte objects, %zu per page, %zu pages, "
+              "%zu in use (peak %zu), %llu allocs, %llu frees\n",
+              cache->name, cache->obj_size, cache->objs_per_slab,
+              cache->slab_cnt, cache->in_use, cache->peak_in_use,
+              cache->alloc_cnt, cache->free_cnt);
+    }
+}
+
+/* Obtains a page from the kernel pool and sets it up as a new
+   slab for CACHE, with all of its objects free and constructed.
+   Returns a null pointer if no page is available. */
+static struct slab *
+slab_create (struct slab_cache *cache)
+{
+  struct slab *slab;
+  uint8_t *obj;
+  size_t i;
+
+  slab = palloc_get_page (0);
+  if (slab == NULL)
+    return NULL;
+
+  slab->magic = SLAB_MAGIC;
+  slab->cache = cache;
+  slab->in_use = 0;
+  slab->free = NULL;
+
+  /* Build the free list back to front, so that objects are
+     handed out in address order. */
+  for (i = cache->objs_per_slab; i-- > 0; )
+    {
+      obj = (uint8_t *) slab + SLAB_OBJS_OFS + i * cache->obj_stride;
+      if (cache->ctor != NULL)
+        cache->ctor (obj);
+      *obj_link (cache, obj) = slab->free;
+      slab->free = obj;
+    }
+
+  cache->slab_cnt++;
+  return slab;
+}
+
+/* Returns the slab that OBJ belongs to, checking that it is a
+   valid object of CACHE. */
+static struct slab *
+obj_to_slab (struct slab_cache *cache, void *obj)
+{
+  struct slab *slab = pg_round_down (obj);
+
+  ASSERT (slab != NULL);
+  ASSERT (slab->magic == SLAB_MAGIC);
+  ASSERT (slab->cache == cache);
+  ASSERT ((pg_ofs (obj) - SLAB_OBJS_OFS) % cache->obj_stride == 0);
+
+  return slab;
+}
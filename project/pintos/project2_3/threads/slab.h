@@ -0,0 +1,46 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Constructor for the objects in a slab cache.  Called once for
+   each object when the page ("slab") holding it is set up, not
+   on every allocation, so an object must be handed back to
+   slab_free() in its constructed state. */
+typedef void slab_ctor (void *obj);
+
+/* A cache of objects of one type, carved out of whole pages. */
+struct slab_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t obj_stride;          /* Bytes from one object to the next. */
+    size_t link_ofs;            /* Offset of free-list link in object. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    slab_ctor *ctor;            /* Constructor, or a null pointer. */
+
+    struct lock lock;           /* Protects everything below. */
+    struct list partial;        /* Slabs with some objects free. */
+    struct list full;           /* Slabs with no objects free. */
+    struct list empty;          /* Slabs with all objects free. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Pages in use by this cache. */
+    size_t in_use;              /* Objects allocated. */
+    size_t peak_in_use;         /* Largest value of IN_USE. */
+    unsigned long long alloc_cnt; /* Calls to slab_alloc(). */
+    unsigned long long free_cnt;  /* Calls to slab_free(). */
+
+    struct list_elem elem;      /* Element in list of all caches. */
+  };
+
+void slab_cache_init (struct slab_cache *, const char *name, size_t size,
+                      slab_ctor *);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+size_t slab_reclaim (void);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -31,6 +31,17 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/* If true, named locks record how long they are waited for and
+   held.  Controlled by kernel command-line option "-lockprof". */
+bool lock_profiling;
+
+/* List of locks named with lock_set_name(). */
+static struct list named_locks = LIST_INITIALIZER (named_locks);
+
+static void lock_acquire_profiled (struct lock *);
+static void lock_record_wait (struct lock *, int64_t start);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -179,6 +190,7 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->name = NULL;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -196,10 +208,33 @@ lock_acquire (struct lock *lock)
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  sema_down (&lock->semaphore);
+  if (lock_profiling && lock->name != NULL)
+    lock_acquire_profiled (lock);
+  else
+    sema_down (&lock->semaphore);
   lock->holder = thread_current ();
 }
 
+/* Acquires named LOCK, as lock_acquire(), recording whether it
+   had to wait and for how long. */
+static void
+lock_acquire_profiled (struct lock *lock)
+{
+  enum intr_level old_level = intr_disable ();
+
+  lock->acquire_cnt++;
+  if (!sema_try_down (&lock->semaphore))
+    {
+      int64_t wait_start = timer_ticks ();
+
+      lock->contended_cnt++;
+      sema_down (&lock->semaphore);
+      lock_record_wait (lock, wait_start);
+    }
+  lock->acquired_at = timer_ticks ();
+  intr_set_level (old_level);
+}
+
 /* Tries to acquires LOCK and returns true if successful or false
    on failure.  The lock must not already be held by the current
    thread.
@@ -216,7 +251,19 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+
+      /* A failed try neither acquires LOCK nor waits for it, so it
+         counts toward neither statistic. */
+      if (lock_profiling && lock->name != NULL)
+        {
+          enum intr_level old_level = intr_disable ();
+          lock->acquire_cnt++;
+          lock->acquired_at = timer_ticks ();
+          intr_set_level (old_level);
+        }
+    }
   return success;
 }
 
@@ -231,6 +278,15 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  if (lock_profiling && lock->name != NULL)
+    {
+      enum intr_level old_level = intr_disable ();
+      int64_t held = timer_ticks () - lock->acquired_at;
+      lock->hold_ticks += held;
+      if (held > lock->max_hold_ticks)
+        lock->max_hold_ticks = held;
+      intr_set_level (old_level);
+    }
   lock->holder = NULL;
   sema_up (&lock->semaphore);
 }
@@ -245,6 +301,108 @@ lock_held_by_current_thread (const struct lock *lock)
 
   return lock->holder == thread_current ();
 }
+
+/* Names LOCK, which makes it show up in lock_print_stats().  Only
+   locks that last until shutdown, such as static ones, should be
+   named.  NAME must also remain valid until then.  Locks given the
+   same NAME are reported together. */
+void
+lock_set_name (struct lock *lock, const char *name)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+
+  old_level = intr_disable ();
+  if (lock->name == NULL)
+    {
+      lock->acquire_cnt = lock->contended_cnt = 0;
+      lock->wait_ticks = lock->max_wait_ticks = 0;
+      lock->hold_ticks = lock->max_hold_ticks = 0;
+      memset (lock->wait_hist, 0, sizeof lock->wait_hist);
+      list_push_back (&named_locks, &lock->prof_elem);
+    }
+  lock->name = name;
+  intr_set_level (old_level);
+}
+
+/* Records that a thread started waiting for LOCK at tick START
+   and has just got it.  Waits go into histogram bucket 0 if they
+   took no ticks, bucket 1 for 1 tick, 2 for 2 or 3 ticks, 3 for
+   4 to 7 ticks, and so on, with the last bucket taking all the
+   longer waits. */
+static void
+lock_record_wait (struct lock *lock, int64_t start)
+{
+  int64_t waited = timer_ticks () - start;
+  int bucket;
+
+  lock->wait_ticks += waited;
+  if (waited > lock->max_wait_ticks)
+    lock->max_wait_ticks = waited;
+  for (bucket = 0; bucket < LOCK_HIST_CNT - 1 && waited >> bucket != 0;
+       bucket++)
+    continue;
+  lock->wait_hist[bucket]++;
+}
+
+/* Prints the profile of every named lock, if lock profiling is
+   enabled.  Locks that share a name, such as the buffer cache's
+   per-entry locks, are summed into a single line. */
+void
+lock_print_stats (void)
+{
+  struct list_elem *e, *f;
+  int i;
+
+  if (!lock_profiling)
+    return;
+
+  printf ("Locks: acquires, contended, wait ticks (total/max), "
+          "hold ticks (total/max), waits of 0, 1, 2-3, 4-7... ticks\n");
+  for (e = list_begin (&named_locks); e != list_end (&named_locks);
+       e = list_next (e))
+    {
+      struct lock *lock = list_entry (e, struct lock, prof_elem);
+      struct lock sum = *lock;
+
+      /* Skip names already printed with an earlier lock. */
+      for (f = list_begin (&named_locks); f != e; f = list_next (f))
+        {
+          struct lock *earlier = list_entry (f, struct lock, prof_elem);
+          if (!strcmp (earlier->name, lock->name))
+            break;
+        }
+      if (f != e)
+        continue;
+
+      for (f = list_next (e); f != list_end (&named_locks); f = list_next (f))
+        {
+          struct lock *other = list_entry (f, struct lock, prof_elem);
+          if (strcmp (other->name, lock->name))
+            continue;
+          sum.acquire_cnt += other->acquire_cnt;
+          sum.contended_cnt += other->contended_cnt;
+          sum.wait_ticks += other->wait_ticks;
+          if (other->max_wait_ticks > sum.max_wait_ticks)
+            sum.max_wait_ticks = other->max_wait_ticks;
+          sum.hold_ticks += other->hold_ticks;
+          if (other->max_hold_ticks > sum.max_hold_ticks)
+            sum.max_hold_ticks = other->max_hold_ticks;
+          for (i = 0; i < LOCK_HIST_CNT; i++)
+            sum.wait_hist[i] += other->wait_hist[i];
+        }
+
+      printf ("%-12s %8u %8u %8lld/%-6lld %8lld/%-6lld",
+              sum.name, sum.acquire_cnt, sum.contended_cnt,
+              sum.wait_ticks, sum.max_wait_ticks,
+              sum.hold_ticks, sum.max_hold_ticks);
+      for (i = 0; i < LOCK_HIST_CNT; i++)
+        printf (" %u", sum.wait_hist[i]);
+      printf ("\n");
+    }
+}
 
 /* One semaphore in a list. */
 struct semaphore_elem 
@@ -3,6 +3,7 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
@@ -17,11 +18,28 @@ bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+/* Lock profiling.  Controlled by kernel command-line option
+   "-lockprof". */
+extern bool lock_profiling;
+#define LOCK_HIST_CNT 8         /* Buckets in wait-time histogram. */
+
 /* Lock. */
 struct lock 
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+
+    /* Profiling, for locks named with lock_set_name(). */
+    const char *name;           /* Name, or a null pointer. */
+    struct list_elem prof_elem; /* Element in list of named locks. */
+    unsigned acquire_cnt;       /* Number of times acquired. */
+    unsigned contended_cnt;     /* Number of times found already held. */
+    int64_t acquired_at;        /* Tick at which last acquired. */
+    int64_t wait_ticks;         /* Total ticks spent waiting. */
+    int64_t max_wait_ticks;     /* Longest single wait. */
+    int64_t hold_ticks;         /* Total ticks held. */
+    int64_t max_hold_ticks;     /* Longest single hold. */
+    unsigned wait_hist[LOCK_HIST_CNT]; /* Waits by length, see synch.c. */
   };
 
 void lock_init (struct lock *);
@@ -29,6 +47,8 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_set_name (struct lock *, const char *name);
+void lock_print_stats (void);
 
 /* Condition variable. */
 struct condition 
@@ -12,7 +12,9 @@
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #ifdef USERPROG
+#include "userprog/pagedir.h"
 #include "userprog/process.h"
 #endif
 
@@ -50,6 +52,13 @@ struct kernel_thread_frame
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+#ifdef USERPROG
+static long long user_faults;   /* # of page faults by exited processes. */
+static long long user_pages_in; /* # of their pages read from swap. */
+static long long user_pages_out; /* # of their pages evicted to swap. */
+static int peak_frames;         /* Largest peak_frame_cnt seen. */
+static char peak_name[16];      /* Name of process with PEAK_FRAMES. */
+#endif
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
@@ -68,6 +77,9 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
+#ifdef USERPROG
+static void print_process_stats (struct thread *, void *aux);
+#endif
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
@@ -75,6 +87,9 @@ static tid_t allocate_tid (void);
 /* Code added for task 2 */
 void init_process (struct process *, pid_t pid);
 
+/* Cache of process records shared between parent and child. */
+static struct slab_cache process_cache;
+
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
@@ -94,8 +109,10 @@ thread_init (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
+  lock_set_name (&tid_lock, "tid");
   list_init (&ready_list);
   list_init (&all_list);
+  slab_cache_init (&process_cache, "process", sizeof (struct process), NULL);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -149,8 +166,37 @@ thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+#ifdef USERPROG
+  {
+    enum intr_level old_level;
+
+    printf ("User: %lld page faults, %lld pages in, %lld pages out",
+            user_faults, user_pages_in, user_pages_out);
+    if (peak_frames > 0)
+      printf (", largest resident set %d pages (%s)", peak_frames, peak_name);
+    printf ("\n");
+
+    old_level = intr_disable ();
+    thread_foreach (print_process_stats, NULL);
+    intr_set_level (old_level);
+  }
+#endif
 }
 
+#ifdef USERPROG
+/* Prints the memory usage of T, if it is a user process. */
+static void
+print_process_stats (struct thread *t, void *aux UNUSED)
+{
+  if (t->pagedir == NULL)
+    return;
+  printf ("  %s: %zu resident pages, %d in working set, "
+          "%u page faults, %u pages in, %u pages out\n",
+          t->name, pagedir_count_present (t->pagedir), t->wss,
+          t->fault_cnt, t->page_in_cnt, t->page_out_cnt);
+}
+#endif
+
 /* Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -206,7 +252,7 @@ thread_create (const char *name, int priority,
   sf->ebp = 0;
 
   /* Create and initialize a new process */
-  struct process *p = (struct process *) malloc (sizeof (struct process));
+  struct process *p = slab_alloc (&process_cache);
   init_process (p, t->tid);
 
   /* Point the thread to the newly-created child process */
@@ -305,11 +351,26 @@ thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
+  malloc_thread_exit ();
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+#ifdef USERPROG
+  {
+    struct thread *cur = thread_current ();
+
+    user_faults += cur->fault_cnt;
+    user_pages_in += cur->page_in_cnt;
+    user_pages_out += cur->page_out_cnt;
+    if (cur->peak_frame_cnt > peak_frames)
+      {
+        peak_frames = cur->peak_frame_cnt;
+        strlcpy (peak_name, cur->name, sizeof peak_name);
+      }
+  }
+#endif
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
@@ -485,13 +546,7 @@ init_thread (struct thread *t, const char *name, int priority)
   t->magic = THREAD_MAGIC;
 
   list_init (&t->children);
-
-  struct file *ptr[FD_LENGTH];
-  t->fd_array = ptr;
-  int i = 0;
-  for (; i < FD_LENGTH; i++) {
-    t->fd_array[i] = NULL;
-  }
+  cond_init (&t->child_exit);
 
   t->cwd = NULL;
   t->proc = NULL;
@@ -616,11 +671,19 @@ void
 init_process (struct process *p, pid_t pid)
 {
   p->child_pid = pid;
-  sema_init(&p->wait_child, 0);
-  p->counter = 2;
-  p->waited_on = false;
-  p->load_success = 2;
-  p->exit_success = false;
+  p->parent = thread_current ();
+  p->ref_cnt = 2;
+  p->exited = false;
+  p->exit_status = -1;
+  sema_init (&p->loaded, 0);
+  p->load_success = false;
+}
+
+/* Frees P, once neither parent nor child needs it any more. */
+void
+free_process (struct process *p)
+{
+  slab_free (&process_cache, p);
 }
 
 
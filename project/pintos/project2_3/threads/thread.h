@@ -8,7 +8,9 @@
 #include <stdlib.h>
 #include "threads/synch.h"
 #include "threads/fixed-point.h"
+#include "threads/malloc.h"
 #include "filesys/file.h"
+#include "userprog/fdtable.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -24,8 +26,6 @@ enum thread_status
 typedef int tid_t;
 #define TID_ERROR ((tid_t) -1)          /* Error value for tid_t. */
 
-#define FD_LENGTH 130
-
 /* Process identifier type. */
 typedef int pid_t;
 
@@ -106,15 +106,32 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    unsigned fault_cnt;                 /* # of page faults taken. */
+    unsigned page_in_cnt;               /* # of pages read from swap. */
+    unsigned page_out_cnt;              /* # of pages evicted to swap. */
+
+    /* Owned by vm/frame.c. */
+    int frame_cnt;                      /* # of evictable frames owned. */
+    int peak_frame_cnt;                 /* Most frames owned at once. */
+    int wss;                            /* Working-set estimate. */
+    int ws_refs;                        /* Frames used this clock lap. */
+    unsigned ws_lap;                    /* Clock lap of WS_REFS. */
 #endif
 
+    /* Owned by threads/malloc.c. */
+    struct malloc_magazine magazines[MALLOC_CLASS_CNT];
+                                        /* Free blocks by size class. */
+
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
 
     /* For project 2. */
     struct process *proc;               /* References process struct shared. */
     struct list children;               /* List all children processes. */
-    struct file **fd_array;
+    struct condition child_exit;        /* Signaled when a child exits. */
+    struct fd_table fds;                /* Open files, by fd. */
+    struct syscall_ring *ring;          /* System call ring, in user
+                                           memory, or null. */
     struct file *exe;
 
     /* For project 3-3. */
@@ -123,17 +140,19 @@ struct thread
 
 /* For project 2. */
 
-/* process that is shared between parent and child thread */
+/* process that is shared between parent and child thread.
+   Fields marked with [P] are protected by the process lock in
+   userprog/process.c. */
 struct process
   {
     pid_t child_pid;                    /* So parent can check for child. */
-    struct semaphore wait_child;
-    int counter;
-    int exit_status;
-    bool exit_success;
-    int load_success;
-    bool waited_on;
-    struct list_elem elem;
+    struct thread *parent;              /* [P] Parent, or null once it exits. */
+    int ref_cnt;                        /* [P] Parent and child, while alive. */
+    bool exited;                        /* [P] Has the child exited? */
+    int exit_status;                    /* -1 unless the child called exit(). */
+    struct semaphore loaded;            /* Upped once load has finished. */
+    bool load_success;                  /* Did load succeed? */
+    struct list_elem elem;              /* Element in parent's children. */
   };
 
 /* If false (default), use round-robin scheduler.
@@ -141,6 +160,8 @@ struct process
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+void free_process (struct process *);
+
 void thread_init (void);
 void thread_start (void);
 
@@ -0,0 +1,107 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+static void worker (void *wq_);
+
+/* Initializes WQ and starts WORKER_CNT threads named after NAME,
+   at the given PRIORITY, to run the work submitted to it.
+   Returns true if successful, false if not even one worker
+   could be started.  NAME must remain valid for as long as WQ is
+   in use.
+
+   Work queues are never torn down, so WQ should have static
+   storage duration. */
+bool
+workqueue_init (struct workqueue *wq, const char *name,
+                int worker_cnt, int priority)
+{
+  int i;
+
+  ASSERT (wq != NULL);
+  ASSERT (name != NULL);
+  ASSERT (worker_cnt > 0);
+  ASSERT (priority >= PRI_MIN && priority <= PRI_MAX);
+
+  wq->name = name;
+  list_init (&wq->pending);
+  sema_init (&wq->pending_cnt, 0);
+  wq->worker_cnt = 0;
+
+  for (i = 0; i < worker_cnt; i++)
+    {
+      char thread_name[16];
+
+      snprintf (thread_name, sizeof thread_name, "%s/%d", name, i);
+      if (thread_create (thread_name, priority, worker, wq) == TID_ERROR)
+        break;
+      wq->worker_cnt++;
+    }
+  return wq->worker_cnt > 0;
+}
+
+/* Queues WORK to be run by one of WQ's workers.  WORK must not
+   already be pending.
+
+   This function does not sleep, so it may be called within an
+   interrupt handler. */
+void
+workqueue_submit (struct workqueue *wq, struct work *work)
+{
+  enum intr_level old_level;
+
+  ASSERT (wq != NULL);
+  ASSERT (work != NULL);
+
+  sema_init (&work->done, 0);
+
+  old_level = intr_disable ();
+  list_push_back (&wq->pending, &work->elem);
+  intr_set_level (old_level);
+
+  sema_up (&wq->pending_cnt);
+}
+
+/* Initializes WORK to run FUNC, passing AUX, when submitted. */
+void
+work_init (struct work *work, work_func *func, void *aux)
+{
+  ASSERT (work != NULL);
+  ASSERT (func != NULL);
+
+  work->func = func;
+  work->aux = aux;
+  sema_init (&work->done, 0);
+}
+
+/* Waits for WORK, which must have been submitted, to complete.
+   Only one thread may wait for a given submission. */
+void
+work_wait (struct work *work)
+{
+  sema_down (&work->done);
+}
+
+/* Worker thread for a work queue: runs pending work, oldest
+   first, forever. */
+static void
+worker (void *wq_)
+{
+  struct workqueue *wq = wq_;
+
+  for (;;)
+    {
+      enum intr_level old_level;
+      struct work *work;
+
+      sema_down (&wq->pending_cnt);
+      old_level = intr_disable ();
+      work = list_entry (list_pop_front (&wq->pending), struct work, elem);
+      intr_set_level (old_level);
+
+      work->func (work->aux);
+      sema_up (&work->done);
+    }
+}
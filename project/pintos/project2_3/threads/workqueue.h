@@ -0,0 +1,45 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include "threads/synch.h"
+
+/* Deferred work, run by a pool of kernel threads.
+
+   Instead of creating a thread for each background task, which
+   costs a page and a tid every time, a subsystem sets up a work
+   queue with a few worker threads once, and then submits
+   "struct work"s to it.  Each worker runs one piece of work at a
+   time, in the order submitted. */
+
+/* Function run as deferred work, passed the work's AUX. */
+typedef void work_func (void *aux);
+
+/* A piece of deferred work.  Owned by its submitter, which must
+   keep it in place until it has completed. */
+struct work
+  {
+    struct list_elem elem;      /* Element in queue's pending list. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Argument for FUNC. */
+    struct semaphore done;      /* Upped once FUNC has returned. */
+  };
+
+/* A queue of pending work and the threads that run it. */
+struct workqueue
+  {
+    const char *name;           /* Name, for debugging. */
+    struct list pending;        /* Work not yet started. */
+    struct semaphore pending_cnt; /* Number of elements in PENDING. */
+    int worker_cnt;             /* Number of worker threads. */
+  };
+
+bool workqueue_init (struct workqueue *, const char *name,
+                     int worker_cnt, int priority);
+void workqueue_submit (struct workqueue *, struct work *);
+
+void work_init (struct work *, work_func *, void *aux);
+void work_wait (struct work *);
+
+#endif /* threads/workqueue.h */
@@ -2,8 +2,11 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/pagedir.h"
+#include "userprog/usermem.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "syscall.h"
 
 /* Number of page faults processed. */
@@ -149,6 +152,30 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+  /* Charge faults on user pages to the process. */
+  if (is_user_vaddr (fault_addr) && thread_current ()->pagedir != NULL)
+    thread_current ()->fault_cnt++;
+
+  /* A write to a page shared copy-on-write since fork() gets a
+     private copy of the page and retries the instruction. */
+  if (!not_present && write && is_user_vaddr (fault_addr)
+      && thread_current ()->pagedir != NULL
+      && pagedir_copy_on_write (thread_current ()->pagedir, fault_addr))
+    return;
+
+  /* A user page that was evicted to swap is read back in, and
+     the access retried.  The kernel may fault on such a page
+     too, while it works on a user buffer. */
+  if (not_present && is_user_vaddr (fault_addr)
+      && thread_current ()->pagedir != NULL
+      && pagedir_page_in (thread_current ()->pagedir, fault_addr))
+    return;
+
+  /* A system call that touched a bad user address gets to
+     report an error instead of taking the kernel down. */
+  if (!user && usermem_fixup (f))
+    return;
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
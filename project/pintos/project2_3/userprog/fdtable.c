@@ -0,0 +1,213 @@
+#include "userprog/fdtable.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+
+/* A process's file descriptor table.
+
+   FILES holds the open file for each descriptor and starts out
+   with room for FD_INITIAL descriptors, doubling whenever it
+   fills up, up to FD_MAX.  USED has a bit set for each descriptor
+   in use, so that the lowest free descriptor, which open() must
+   return, is found by scanning the bitmap a word at a time from
+   NEXT_FREE.  Since no descriptor below NEXT_FREE is free, a
+   process that opens files without closing any never scans
+   more than one word.
+
+   Only the owning process uses its table, so there is no
+   locking. */
+
+/* Number of descriptors a new table has room for. */
+#define FD_INITIAL 16
+
+static bool grow (struct fd_table *, int min_size);
+
+/* Initializes T as an empty table.  Returns true if successful,
+   false if memory is not available. */
+bool
+fd_table_init (struct fd_table *t)
+{
+  t->files = calloc (FD_INITIAL, sizeof *t->files);
+  t->used = bitmap_create (FD_INITIAL);
+  t->size = FD_INITIAL;
+  t->next_free = FD_FIRST;
+  if (t->files == NULL || t->used == NULL)
+    {
+      fd_table_destroy (t);
+      return false;
+    }
+
+  /* The console descriptors are always in use. */
+  bitmap_set_multiple (t->used, 0, FD_FIRST, true);
+  return true;
+}
+
+/* Initializes T as a copy of SRC, with each open file in SRC
+   reopened at the same position.  Returns true if successful,
+   false if memory is not available. */
+bool
+fd_table_clone (struct fd_table *t, const struct fd_table *src)
+{
+  int fd;
+
+  if (!fd_table_init (t) || !grow (t, src->size))
+    {
+      fd_table_destroy (t);
+      return false;
+    }
+
+  for (fd = FD_FIRST; fd < src->size; fd++)
+    if (src->files[fd] != NULL)
+      {
+        struct file *file = file_reopen (src->files[fd]);
+        if (file == NULL)
+          {
+            fd_table_destroy (t);
+            return false;
+          }
+        file_seek (file, file_tell (src->files[fd]));
+        t->files[fd] = file;
+        bitmap_mark (t->used, fd);
+      }
+  t->next_free = src->next_free;
+  return true;
+}
+
+/* Closes every file in T and frees T's memory. */
+void
+fd_table_destroy (struct fd_table *t)
+{
+  int fd;
+
+  if (t->files != NULL)
+    for (fd = FD_FIRST; fd < t->size; fd++)
+      file_close (t->files[fd]);
+  free (t->files);
+  if (t->used != NULL)
+    bitmap_destroy (t->used);
+  t->files = NULL;
+  t->used = NULL;
+  t->size = 0;
+}
+
+/* Gives FILE the lowest free descriptor in T and returns it.
+   Returns -1, without closing FILE, if T is full or memory is not
+   available. */
+int
+fd_install (struct fd_table *t, struct file *file)
+{
+  size_t fd;
+
+  ASSERT (file != NULL);
+
+  fd = bitmap_scan_and_flip (t->used, t->next_free, 1, false);
+  if (fd == BITMAP_ERROR)
+    {
+      /* Every descriptor that fits is in use, so the lowest free
+         one is the first that does not fit yet. */
+      fd = t->size;
+      if (!grow (t, t->size + 1))
+        return -1;
+      bitmap_mark (t->used, fd);
+    }
+
+  t->files[fd] = file;
+  t->next_free = fd + 1;
+  return fd;
+}
+
+/* Returns the file that FD refers to in T, or a null pointer if
+   FD is not open or is a console descriptor. */
+struct file *
+fd_lookup (const struct fd_table *t, int fd)
+{
+  return fd >= FD_FIRST && fd < t->size ? t->files[fd] : NULL;
+}
+
+/* Frees descriptor FD in T and returns the file it referred to,
+   which the caller must close.  Returns a null pointer if FD is
+   not open or is a console descriptor. */
+struct file *
+fd_remove (struct fd_table *t, int fd)
+{
+  struct file *file = fd_lookup (t, fd);
+
+  if (file != NULL)
+    {
+      t->files[fd] = NULL;
+      bitmap_reset (t->used, fd);
+      if (fd < t->next_free)
+        t->next_free = fd;
+    }
+  return file;
+}
+
+/* Makes NEW_FD in T refer to the same open file as OLD_FD, so
+   that the two share a file position, first closing whatever
+   NEW_FD referred to.  Returns NEW_FD if successful, or -1 if
+   OLD_FD is not open, NEW_FD is out of range, or memory is not
+   available.  Console descriptors cannot be duplicated. */
+int
+fd_dup2 (struct fd_table *t, int old_fd, int new_fd)
+{
+  struct file *file = fd_lookup (t, old_fd);
+
+  if (file == NULL || new_fd < FD_FIRST || new_fd >= FD_MAX)
+    return -1;
+  if (new_fd == old_fd)
+    return new_fd;
+  if (new_fd >= t->size && !grow (t, new_fd + 1))
+    return -1;
+
+  file_close (fd_remove (t, new_fd));
+  t->files[new_fd] = file_dup (file);
+  bitmap_mark (t->used, new_fd);
+  return new_fd;
+}
+
+/* Enlarges T, if necessary, to have room for at least MIN_SIZE
+   descriptors.  Returns true if successful, false if MIN_SIZE is
+   greater than FD_MAX or memory is not available. */
+static bool
+grow (struct fd_table *t, int min_size)
+{
+  struct file **files;
+  struct bitmap *used;
+  int size, fd;
+
+  if (min_size <= t->size)
+    return true;
+  if (min_size > FD_MAX)
+    return false;
+
+  size = t->size;
+  while (size < min_size)
+    size *= 2;
+  if (size > FD_MAX)
+    size = FD_MAX;
+
+  files = calloc (size, sizeof *files);
+  used = bitmap_create (size);
+  if (files == NULL || used == NULL)
+    {
+      free (files);
+      if (used != NULL)
+        bitmap_destroy (used);
+      return false;
+    }
+
+  memcpy (files, t->files, t->size * sizeof *files);
+  bitmap_set_multiple (used, 0, FD_FIRST, true);
+  for (fd = FD_FIRST; fd < t->size; fd++)
+    if (files[fd] != NULL)
+      bitmap_mark (used, fd);
+
+  free (t->files);
+  bitmap_destroy (t->used);
+  t->files = files;
+  t->used = used;
+  t->size = size;
+  return true;
+}
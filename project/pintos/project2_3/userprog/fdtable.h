@@ -0,0 +1,35 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct bitmap;
+struct file;
+
+/* File descriptors 0 and 1 are the console, not files in the
+   table. */
+#define FD_FIRST 2
+
+/* Largest number of file descriptors a process may have. */
+#define FD_MAX 8192
+
+/* A process's open files, indexed by file descriptor. */
+struct fd_table
+  {
+    struct file **files;        /* Open file for each fd, or null. */
+    struct bitmap *used;        /* Bit set for each fd in use. */
+    int size;                   /* Number of fds that fit. */
+    int next_free;              /* No fd below this one is free. */
+  };
+
+bool fd_table_init (struct fd_table *);
+bool fd_table_clone (struct fd_table *, const struct fd_table *);
+void fd_table_destroy (struct fd_table *);
+
+int fd_install (struct fd_table *, struct file *);
+struct file *fd_lookup (const struct fd_table *, int fd);
+struct file *fd_remove (struct fd_table *, int fd);
+int fd_dup2 (struct fd_table *, int old_fd, int new_fd);
+
+#endif /* userprog/fdtable.h */
@@ -3,8 +3,12 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/thread.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
@@ -23,7 +27,9 @@ pagedir_create (void)
 }
 
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references, including those paged out to swap.  User pages
+   still shared copy-on-write with another page directory are
+   left to their remaining owners. */
 void
 pagedir_destroy (uint32_t *pd) 
 {
@@ -33,6 +39,7 @@ pagedir_destroy (uint32_t *pd)
     return;
 
   ASSERT (pd != init_page_dir);
+  frame_forget_pagedir (pd);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
     if (*pde & PTE_P) 
       {
@@ -41,7 +48,9 @@ pagedir_destroy (uint32_t *pd)
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+            frame_free (pte_get_page (*pte));
+          else if (*pte & PTE_SWAP)
+            swap_free (*pte >> PGBITS);
         palloc_free_page (pt);
       }
   palloc_free_page (pd);
@@ -118,6 +127,22 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     return false;
 }
 
+/* Adds a read-only mapping in page directory PD from user
+   virtual page UPAGE to KPAGE, a frame shared with other
+   mappings, marked copy-on-write so that the first write to
+   UPAGE gives it a private copy of KPAGE.
+   UPAGE must not already be mapped.
+   Returns true if successful, false if memory allocation
+   failed. */
+bool
+pagedir_set_page_cow (uint32_t *pd, void *upage, void *kpage)
+{
+  if (!pagedir_set_page (pd, upage, kpage, false))
+    return false;
+  *lookup_page (pd, upage, false) |= PTE_COW;
+  return true;
+}
+
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
@@ -156,6 +181,248 @@ pagedir_clear_page (uint32_t *pd, void *upage)
     }
 }
 
+/* Makes CHILD, a freshly created page directory, a
+   copy-on-write clone of the user mappings in PARENT.  Every
+   writable page of PARENT becomes read-only and shared in both
+   page directories; the first write to it by either side takes
+   a page fault that pagedir_copy_on_write() resolves by giving
+   the writer a private copy.  Pages of PARENT that are out in
+   swap are read back in first.  Returns true if successful,
+   false if memory for CHILD's page tables could not be
+   obtained.  On
+   failure, CHILD holds whatever was shared so far and should be
+   destroyed with pagedir_destroy(). */
+bool
+pagedir_clone (uint32_t *child, uint32_t *parent)
+{
+  uint32_t *pde;
+
+  ASSERT (child != init_page_dir && parent != init_page_dir);
+
+  for (pde = parent; pde < parent + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P)
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        size_t i;
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+          if (pt[i] & (PTE_P | PTE_SWAP))
+            {
+              void *upage = (void *) (((pde - parent) << PDSHIFT)
+                                      | (i << PTSHIFT));
+              uint32_t *cpte = lookup_page (child, upage, true);
+
+              /* Keep the page from being evicted until it is
+                 shared, and so no longer evictable. */
+              if (cpte == NULL
+                  || pagedir_pin_page (parent, upage, false) == NULL)
+                {
+                  invalidate_pagedir (parent);
+                  return false;
+                }
+
+              if (pt[i] & PTE_W)
+                pt[i] = (pt[i] & ~(uint32_t) PTE_W) | PTE_COW;
+              frame_share (pte_get_page (pt[i]));
+              *cpte = pt[i];
+              pagedir_unpin_page (parent, upage);
+            }
+      }
+
+  /* Write access to PARENT's pages was revoked above. */
+  invalidate_pagedir (parent);
+  return true;
+}
+
+/* Resolves a write to copy-on-write user virtual address UADDR
+   in PD.  If the frame behind it is still shared, the page is
+   remapped to a private copy (a freshly zeroed frame in place of
+   the shared zero frame); otherwise the last remaining
+   mapping simply becomes writable again.  Returns true if UADDR
+   is now writable (including if it already was), false if it is
+   unmapped, read-only, or no frame was available for the copy. */
+bool
+pagedir_copy_on_write (uint32_t *pd, const void *uaddr)
+{
+  uint32_t *pte;
+  void *kpage;
+
+  ASSERT (is_user_vaddr (uaddr));
+
+  pte = lookup_page (pd, uaddr, false);
+  if (pte == NULL || (*pte & PTE_P) == 0)
+    return false;
+  if (*pte & PTE_W)
+    return true;
+  if ((*pte & PTE_COW) == 0)
+    return false;
+
+  kpage = pte_get_page (*pte);
+  if (frame_is_zero (kpage))
+    {
+      void *copy = frame_alloc (PAL_ZERO);
+      if (copy == NULL)
+        return false;
+      *pte = pte_create_user (copy, true) | (*pte & PTE_A);
+      frame_free (kpage);
+      kpage = copy;
+    }
+  else if (frame_is_shared (kpage))
+    {
+      void *copy = frame_alloc (0);
+      if (copy == NULL)
+        return false;
+      memcpy (copy, kpage, PGSIZE);
+      *pte = pte_create_user (copy, true) | (*pte & PTE_A);
+      frame_free (kpage);
+      kpage = copy;
+    }
+  else
+    *pte = (*pte | PTE_W) & ~(uint32_t) PTE_COW;
+
+  invalidate_pagedir (pd);
+  frame_set_owner (kpage, pd, pg_round_down (uaddr));
+  return true;
+}
+
+/* Reads the page at user virtual address UADDR in PD, the
+   current process's page directory, back in from swap, if it
+   was paged out.  Returns true if UADDR is now present, false
+   if it is unmapped or no frame was available to read it
+   into. */
+bool
+pagedir_page_in (uint32_t *pd, const void *uaddr)
+{
+  uint32_t *pte;
+  uint32_t flags;
+  size_t slot;
+  void *kpage;
+
+  ASSERT (is_user_vaddr (uaddr));
+
+  pte = lookup_page (pd, uaddr, false);
+  if (pte == NULL || (*pte & (PTE_P | PTE_SWAP)) == 0)
+    return false;
+  if (*pte & PTE_P)
+    return true;
+
+  /* Only PD's own process touches a PTE that is out in swap, so
+     it cannot change while we wait for a frame and the read. */
+  slot = *pte >> PGBITS;
+  flags = *pte & PTE_COW;
+  kpage = frame_alloc (0);
+  if (kpage == NULL)
+    return false;
+  swap_read (slot, kpage);
+  swap_free (slot);
+  thread_current ()->page_in_cnt++;
+
+  /* Start out accessed, so that the page gets a chance to be
+     used before the evictor considers it again. */
+  *pte = pte_create_user (kpage, (*pte & PTE_W) != 0) | flags | PTE_A;
+  frame_set_owner (kpage, pd, pg_round_down (uaddr));
+  return true;
+}
+
+/* Evicts user page UPAGE in PD, which must map frame KPAGE, to
+   swap slot SLOT, into which its contents have been written.
+   Fails, leaving the page mapped, if UPAGE no longer maps KPAGE
+   or has been written since the write to swap began.  Must be
+   called with interrupts off, so that the check and the update
+   are atomic with respect to the owning process. */
+bool
+pagedir_swap_out (uint32_t *pd, const void *upage, void *kpage, size_t slot)
+{
+  uint32_t *pte;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  pte = lookup_page (pd, upage, false);
+  if (pte == NULL || (*pte & (PTE_P | PTE_D)) != PTE_P
+      || pte_get_page (*pte) != kpage)
+    return false;
+
+  *pte = ((uint32_t) slot << PGBITS) | PTE_SWAP
+         | (*pte & (PTE_W | PTE_COW));
+  invalidate_pagedir (pd);
+  return true;
+}
+
+/* Returns the number of user pages present in PD, including
+   pages shared with other page directories. */
+size_t
+pagedir_count_present (uint32_t *pd)
+{
+  size_t cnt = 0;
+  uint32_t *pde;
+
+  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P)
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        size_t i;
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+          if (pt[i] & PTE_P)
+            cnt++;
+      }
+  return cnt;
+}
+
+/* Returns true if user virtual address UADDR in PD is paged out
+   to swap. */
+bool
+pagedir_is_swapped (uint32_t *pd, const void *uaddr)
+{
+  uint32_t *pte = lookup_page (pd, uaddr, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_SWAP)) == PTE_SWAP;
+}
+
+/* Pins the frame that user virtual address UADDR in PD maps to,
+   so that it stays in memory until pagedir_unpin_page(), and
+   returns the kernel virtual address corresponding to UADDR.
+   The page is read back in first if it is out in swap.
+   If WRITE is true, the page is first made writable, breaking
+   any copy-on-write sharing, since the kernel will write to it
+   through its own mapping.  Returns a null pointer, pinning
+   nothing, if UADDR is unmapped or (if WRITE) read-only. */
+void *
+pagedir_pin_page (uint32_t *pd, const void *uaddr, bool write)
+{
+  void *kaddr;
+
+  /* The page may be evicted again between any two steps, in
+     which case we start over. */
+  do
+    {
+      if (!pagedir_page_in (pd, uaddr))
+        return NULL;
+      if (write && !pagedir_copy_on_write (pd, uaddr)
+          && !pagedir_is_swapped (pd, uaddr))
+        return NULL;
+      kaddr = frame_pin_page (pd, uaddr);
+    }
+  while (kaddr == NULL);
+
+  /* Writes through KADDR bypass the user PTE, so mark it dirty
+     by hand.  That also cancels any eviction of the page that
+     is already under way. */
+  if (write)
+    pagedir_set_dirty (pd, pg_round_down (uaddr), true);
+  return kaddr;
+}
+
+/* Releases a pin taken with pagedir_pin_page() on the frame
+   that user virtual address UADDR in PD maps to. */
+void
+pagedir_unpin_page (uint32_t *pd, const void *uaddr)
+{
+  void *kaddr = pagedir_get_page (pd, uaddr);
+
+  ASSERT (kaddr != NULL);
+  frame_unpin (pg_round_down (kaddr));
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
@@ -214,6 +481,32 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
     }
 }
 
+/* Returns whether the PTE for virtual page VPAGE in PD has been
+   accessed since it was last cleared, and clears it.  The test
+   and the update are atomic with respect to the process that
+   owns PD, so that PD can be sampled while that process is
+   preempted.  Returns false if PD contains no PTE for VPAGE. */
+bool
+pagedir_test_and_clear_accessed (uint32_t *pd, const void *vpage)
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  enum intr_level old_level;
+  bool accessed;
+
+  if (pte == NULL)
+    return false;
+
+  old_level = intr_disable ();
+  accessed = (*pte & PTE_A) != 0;
+  if (accessed)
+    {
+      *pte &= ~(uint32_t) PTE_A;
+      invalidate_pagedir (pd);
+    }
+  intr_set_level (old_level);
+  return accessed;
+}
+
 /* Loads page directory PD into the CPU's page directory base
    register. */
 void
@@ -2,17 +2,29 @@
 #define USERPROG_PAGEDIR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 uint32_t *pagedir_create (void);
 void pagedir_destroy (uint32_t *pd);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_set_page_cow (uint32_t *pd, void *upage, void *kpage);
 void *pagedir_get_page (uint32_t *pd, const void *upage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
+bool pagedir_clone (uint32_t *child, uint32_t *parent);
+bool pagedir_copy_on_write (uint32_t *pd, const void *uaddr);
+bool pagedir_page_in (uint32_t *pd, const void *uaddr);
+bool pagedir_swap_out (uint32_t *pd, const void *upage, void *kpage,
+                       size_t slot);
+bool pagedir_is_swapped (uint32_t *pd, const void *uaddr);
+size_t pagedir_count_present (uint32_t *pd);
+void *pagedir_pin_page (uint32_t *pd, const void *uaddr, bool write);
+void pagedir_unpin_page (uint32_t *pd, const void *uaddr);
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
 void pagedir_set_accessed (uint32_t *pd, const void *upage, bool accessed);
+bool pagedir_test_and_clear_accessed (uint32_t *pd, const void *upage);
 void pagedir_activate (uint32_t *pd);
 
 #endif /* userprog/pagedir.h */
@@ -5,12 +5,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/fdtable.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
@@ -19,13 +21,20 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "vm/frame.h"
 #include "syscall.h"
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static thread_func start_fork NO_RETURN;
+static bool load (char *cmd_line, void (**eip) (void), void **esp);
+static void loaded (bool success);
+static void reap (struct process *);
 void remove_children (void);
 void free_fds (void);
 
+/* Protects the fields of every struct process marked [P]. */
+static struct lock process_lock;
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -62,20 +71,18 @@ start_process (void *file_name_)
 {
   char *file_name = file_name_;
   struct intr_frame if_;
-  bool success;
+  bool success = false;
 
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  if (fd_table_init (&thread_current ()->fds))
+    success = load (file_name, &if_.eip, &if_.esp);
 
-  /* Set load_success. */
-  if (success)
-    thread_current ()->proc->load_success = 1;
-  else
-    thread_current ()->proc->load_success = 0;
+  /* Let exec() in the parent return. */
+  loaded (success);
 
   /* If load failed, quit. */
   palloc_free_page (file_name);
@@ -93,53 +100,211 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* State handed from a process calling fork() to its child. */
+struct fork_args
+  {
+    struct intr_frame if_;              /* Parent's user registers. */
+    uint32_t *pagedir;                  /* Copy-on-write address space. */
+    struct fd_table fds;                /* Duplicated file descriptors. */
+    struct syscall_ring *ring;          /* System call ring. */
+    struct file *exe;                   /* Reopened executable. */
+  };
+
+/* Creates a child of the running process that is a copy of it,
+   resuming in user mode from the register state in F with a
+   return value of 0.  The child's address space is cloned
+   copy-on-write rather than copied, so the cost of forking
+   grows with the pages either side later writes to, not with
+   the size of the address space.  Open files are duplicated and
+   start at the same position as the parent's.  Returns the
+   child's thread id, or TID_ERROR if it cannot be created. */
+tid_t
+process_fork (const struct intr_frame *f)
+{
+  struct thread *cur = thread_current ();
+  struct fork_args *args;
+  tid_t tid;
+
+  args = calloc (1, sizeof *args);
+  if (args == NULL)
+    return TID_ERROR;
+  args->if_ = *f;
+
+  args->pagedir = pagedir_create ();
+  if (args->pagedir == NULL
+      || !pagedir_clone (args->pagedir, cur->pagedir))
+    goto error;
+
+  if (!fd_table_clone (&args->fds, &cur->fds))
+    goto error;
+  args->ring = cur->ring;
+
+  if (cur->exe != NULL)
+    {
+      args->exe = file_reopen (cur->exe);
+      if (args->exe == NULL)
+        goto error;
+      file_deny_write (args->exe);
+    }
+
+  tid = thread_create (cur->name, PRI_DEFAULT, start_fork, args);
+  if (tid != TID_ERROR)
+    return tid;
+
+ error:
+  fd_table_destroy (&args->fds);
+  file_close (args->exe);
+  pagedir_destroy (args->pagedir);
+  free (args);
+  return TID_ERROR;
+}
+
+/* A thread function that takes over the address space and
+   files prepared by process_fork() and returns to user mode
+   where the parent left off. */
+static void
+start_fork (void *args_)
+{
+  struct fork_args *args = args_;
+  struct thread *t = thread_current ();
+  struct intr_frame if_ = args->if_;
+
+  t->pagedir = args->pagedir;
+  t->fds = args->fds;
+  t->ring = args->ring;
+  t->exe = args->exe;
+  free (args);
+  process_activate ();
+
+  /* A forked child has nothing left to load. */
+  loaded (true);
+
+  /* fork() returns 0 in the child. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Records whether the running process loaded successfully and
+   wakes its parent, which may be waiting in exec(). */
+static void
+loaded (bool success)
+{
+  struct process *p = thread_current ()->proc;
+
+  p->load_success = success;
+  sema_up (&p->loaded);
+}
+
+/* Waits for the child process with tid CHILD_TID to finish
+   loading.  Returns true if it loaded successfully, false if it
+   failed to or CHILD_TID is not a child of the running thread. */
+bool
+process_wait_load (tid_t child_tid)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  /* Only this thread changes its list of children, so it needs
+     no lock to walk it. */
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = list_next (e))
+    {
+      struct process *p = list_entry (e, struct process, elem);
+      if (p->child_pid == child_tid)
+        {
+          sema_down (&p->loaded);
+          return p->load_success;
+        }
+    }
+  return false;
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   immediately, without waiting. */
 int
-process_wait (tid_t child_tid UNUSED)
+process_wait (tid_t child_tid)
 {
+  struct thread *cur = thread_current ();
+  struct process *child = NULL;
   struct list_elem *e;
-  struct thread *current = thread_current ();
-  bool found = false;
-  struct process *child_process = NULL;
+  int status;
 
-  /* If invalid tid. */
-  if (child_tid < 0)
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = list_next (e))
+    {
+      struct process *p = list_entry (e, struct process, elem);
+      if (p->child_pid == child_tid)
+        {
+          child = p;
+          break;
+        }
+    }
+  if (child == NULL)
     return -1;
 
-  /* Search current thread's children for tid. */
-  for (e = list_begin (&current->children); 
-       e != list_end (&current->children) && !found;
-       e = list_next (e))
-  {
-    child_process = list_entry (e, struct process, elem);
-    if (child_process->child_pid == child_tid)
-      found = true;
-  }
+  lock_acquire (&process_lock);
+  while (!child->exited)
+    cond_wait (&cur->child_exit, &process_lock);
+  status = child->exit_status;
+  reap (child);
+  lock_release (&process_lock);
+  return status;
+}
 
-  /* If not found, tid either DNE or is not a child of current. */
-  if (!found || !child_process || child_process->waited_on)
-    return -1;
+/* Waits for any child of the running thread to die, stores its
+   exit status in *STATUS if STATUS is nonnull, and returns its
+   tid.  Children that have already died are returned first,
+   without waiting.  Returns -1 immediately if the running
+   thread has no children left to wait for. */
+tid_t
+process_wait_any (int *status)
+{
+  struct thread *cur = thread_current ();
+  tid_t tid = -1;
 
-  /* Set waited_on since we can call wait on a tid at most once. */
-  child_process->waited_on = true;
+  lock_acquire (&process_lock);
+  while (!list_empty (&cur->children))
+    {
+      struct list_elem *e;
 
-  if (child_process->exit_success == true)
-    return child_process->exit_status;
+      for (e = list_begin (&cur->children); e != list_end (&cur->children);
+           e = list_next (e))
+        {
+          struct process *p = list_entry (e, struct process, elem);
+          if (p->exited)
+            {
+              tid = p->child_pid;
+              if (status != NULL)
+                *status = p->exit_status;
+              reap (p);
+              break;
+            }
+        }
+      if (tid != -1)
+        break;
+      cond_wait (&cur->child_exit, &process_lock);
+    }
+  lock_release (&process_lock);
+  return tid;
+}
 
-  /* Wait for child to exit and call sema_up. */
-  sema_down (&(child_process->wait_child));
+/* Removes dead child P from the running thread's children,
+   so that it cannot be waited for again, and frees it.  Must
+   hold process_lock. */
+static void
+reap (struct process *p)
+{
+  ASSERT (lock_held_by_current_thread (&process_lock));
+  ASSERT (p->exited);
 
-  if (child_process->exit_success != true)
-    return -1;
-  return child_process->exit_status;
+  list_remove (&p->elem);
+  if (--p->ref_cnt == 0)
+    free_process (p);
 }
 
 /* Free the current process's resources. */
@@ -158,6 +323,24 @@ process_exit (void)
   /* Remove all child structs if need be. */
   remove_children ();
 
+  /* Tell our parent we are done.  Our exit status, if any, was
+     stored by exit(). */
+  if (cur->proc != NULL)
+    {
+      struct process *p = cur->proc;
+      bool last;
+
+      lock_acquire (&process_lock);
+      p->exited = true;
+      if (p->parent != NULL)
+        cond_signal (&p->parent->child_exit, &process_lock);
+      last = --p->ref_cnt == 0;
+      lock_release (&process_lock);
+      if (last)
+        free_process (p);
+      cur->proc = NULL;
+    }
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -255,37 +438,94 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
+/* Most arguments a command line may have. */
+#define ARG_MAX 32
+
+/* A loadable segment of an executable, already checked by
+   validate_segment() and reduced to what load_segment() needs. */
+struct exec_segment
+  {
+    uint32_t file_page;         /* Page-aligned offset in the file. */
+    uint32_t mem_page;          /* Page-aligned user virtual address. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero after them. */
+    bool writable;              /* Map read/write or read-only? */
+  };
+
+/* Most loadable segments an executable may have.  Pintos
+   programs have two or three. */
+#define EXEC_SEGMENT_MAX 8
+
+/* What load() needs from an executable's headers. */
+struct exec_image
+  {
+    void (*entry) (void);                       /* Entry point. */
+    int segment_cnt;                            /* Number of segments. */
+    struct exec_segment segments[EXEC_SEGMENT_MAX];
+  };
+
+/* Executables loaded recently, keyed by inode sector, so that
+   running one again skips reading and checking its headers.
+
+   Each entry keeps its inode open.  That way every writer goes
+   through the same in-memory inode, and a change in its write
+   count shows that the cached image may be stale.  Headers read
+   while a write was under way are not cached.  An entry is
+   dropped as soon as its file is removed, so that the removed
+   file's sectors can be freed. */
+#define EXEC_CACHE_SIZE 8
+
+struct exec_cache_entry
+  {
+    struct inode *inode;        /* Executable, or null if unused. */
+    unsigned write_cnt;         /* inode_get_write_cnt() when read. */
+    unsigned last_use;          /* exec_clock at last use. */
+    struct exec_image image;    /* Parsed headers. */
+  };
+
+static struct exec_cache_entry exec_cache[EXEC_CACHE_SIZE];
+static unsigned exec_clock;             /* Ticks once per use. */
+static struct lock exec_cache_lock;     /* Protects the above. */
+
 static bool setup_stack (void **esp);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
-bool check_if_valid (char *file_name);
+static bool read_exec_image (const char *name, struct file *,
+                             struct exec_image *);
+static bool exec_cache_lookup (struct inode *, struct exec_image *);
+static void exec_cache_insert (struct inode *, unsigned write_cnt,
+                               const struct exec_image *);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
-   Stores the executable's entry point into *EIP
+/* Initializes process bookkeeping and the executable cache. */
+void
+process_init (void)
+{
+  lock_init (&process_lock);
+  lock_init (&exec_cache_lock);
+}
+
+/* Loads an ELF executable from the command line CMD_LINE into
+   the current thread, breaking CMD_LINE into arguments in
+   place.  Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
-bool
-load (const char *file_name, void (**eip) (void), void **esp)
+static bool
+load (char *cmd_line, void (**eip) (void), void **esp)
 {
   struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
+  struct exec_image image;
   struct file *file = NULL;
-  off_t file_ofs;
+  struct inode *inode;
   bool success = false;
   int i;
 
-  /* Initialize variables that are needed when arguments parsing */
-  char *fn_copy;
-  char *checking;
-  char *curr_arg;
-  char *exec_name;
-  size_t curr_arg_len;
-  char *argv[33];
-  size_t argc = 0;
-  char *saveptr;
-  unsigned int padding;
+  char *args[ARG_MAX];
+  char *argv[ARG_MAX + 1];
+  char **user_argv;
+  int argc = 0;
+  char *arg, *saveptr;
 
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
@@ -293,30 +533,114 @@ load (const char *file_name, void (**eip) (void), void **esp)
     goto done;
   process_activate ();
 
-  /* To avoid a race condition, make a copy of file_name */
-  fn_copy = palloc_get_page (0);
-  checking = palloc_get_page (0);
-  if (fn_copy == NULL) {
+  /* Split the command line into arguments. */
+  for (arg = strtok_r (cmd_line, " ", &saveptr); arg != NULL;
+       arg = strtok_r (NULL, " ", &saveptr))
+    {
+      if (argc == ARG_MAX)
+        {
+          printf ("Too many arguments\n");
+          goto done;
+        }
+      args[argc++] = arg;
+    }
+  if (argc == 0)
     goto done;
-  }
-  strlcpy (fn_copy, file_name, PGSIZE);
-  strlcpy (checking, file_name, PGSIZE);
-
-  /* Check if arguments given are valid */
-  if (check_if_valid (checking) == false) goto done;
-
-  /* Get the executable's name (or syscall) to open */
-  exec_name = strtok_r (fn_copy, " ", &saveptr);
 
   /* Open executable file. */
-  file = filesys_open (exec_name);
+  file = filesys_open (args[0]);
   if (file == NULL)
     {
-      printf ("load: %s: open failed\n", exec_name);
+      printf ("load: %s: open failed\n", args[0]);
       goto done;
     }
 
+  /* Read its headers, unless they are cached. */
+  inode = file_get_inode (file);
+  if (!exec_cache_lookup (inode, &image))
+    {
+      unsigned write_cnt = inode_get_write_cnt (inode);
+      if (!read_exec_image (args[0], file, &image))
+        goto done;
+      exec_cache_insert (inode, write_cnt, &image);
+    }
+
+  /* Load segments. */
+  for (i = 0; i < image.segment_cnt; i++)
+    {
+      const struct exec_segment *s = &image.segments[i];
+      if (!load_segment (file, s->file_page, (void *) s->mem_page,
+                         s->read_bytes, s->zero_bytes, s->writable))
+        goto done;
+    }
+
+  /* Set up stack. */
+  if (!setup_stack (esp))
+    goto done;
+
+  /* Push the arguments, starting with the executable's name,
+     and record where each one lands. */
+  for (i = 0; i < argc; i++)
+    {
+      size_t arg_len = strlen (args[i]) + 1;
+      *esp = (char *) *esp - arg_len;
+      memcpy (*esp, args[i], arg_len);
+      argv[i] = *esp;
+    }
+  argv[argc] = NULL;
+
+  /* Word-align the stack pointer. */
+  *esp = (char *) *esp - (uintptr_t) *esp % 4;
+
+  /* Push argv[argc] down to argv[0]. */
+  *esp = (char *) *esp - sizeof *argv * (argc + 1);
+  memcpy (*esp, argv, sizeof *argv * (argc + 1));
+
+  /* Push argv. */
+  user_argv = *esp;
+  *esp = (char *) *esp - sizeof user_argv;
+  memcpy (*esp, &user_argv, sizeof user_argv);
+
+  /* Push argc. */
+  *esp = (char *) *esp - sizeof argc;
+  memcpy (*esp, &argc, sizeof argc);
+
+  /* Push a fake return address. */
+  *esp = (char *) *esp - 4;
+
+  /* Start address. */
+  *eip = image.entry;
+
+  success = true;
+  t->exe = file; 
+  file_deny_write (t->exe);
+
+ done:
+  /* We arrive here whether the load is successful or not. */
+  if (!success)
+    file_close (file);
+  return success;
+}
+
+/* load() helpers. */
+
+static bool install_page (void *upage, void *kpage, bool writable);
+static bool install_zero_page (void *upage, bool writable);
+
+/* Reads and checks the headers of executable FILE, named NAME,
+   and stores what they say to load into *IMAGE.
+   Returns true if successful, false if FILE is not a valid
+   executable. */
+static bool
+read_exec_image (const char *name, struct file *file,
+                 struct exec_image *image)
+{
+  struct Elf32_Ehdr ehdr;
+  off_t file_ofs;
+  int i;
+
   /* Read and verify executable header. */
+  file_seek (file, 0);
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
       || ehdr.e_type != 2
@@ -325,22 +649,24 @@ load (const char *file_name, void (**eip) (void), void **esp)
       || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
       || ehdr.e_phnum > 1024)
     {
-      printf ("load: %s: error loading executable\n", exec_name);
-      goto done;
+      printf ("load: %s: error loading executable\n", name);
+      return false;
     }
 
   /* Read program headers. */
+  image->entry = (void (*) (void)) ehdr.e_entry;
+  image->segment_cnt = 0;
   file_ofs = ehdr.e_phoff;
   for (i = 0; i < ehdr.e_phnum; i++)
     {
       struct Elf32_Phdr phdr;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
+        return false;
       file_seek (file, file_ofs);
 
       if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+        return false;
       file_ofs += sizeof phdr;
       switch (phdr.p_type)
         {
@@ -354,115 +680,141 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          goto done;
+          return false;
         case PT_LOAD:
-          if (validate_segment (&phdr, file))
+          if (validate_segment (&phdr, file)
+              && image->segment_cnt < EXEC_SEGMENT_MAX)
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
+              struct exec_segment *s = &image->segments[image->segment_cnt++];
               uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
+              s->writable = (phdr.p_flags & PF_W) != 0;
+              s->file_page = phdr.p_offset & ~PGMASK;
+              s->mem_page = phdr.p_vaddr & ~PGMASK;
               if (phdr.p_filesz > 0)
                 {
                   /* Normal segment.
                      Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
+                  s->read_bytes = page_offset + phdr.p_filesz;
+                  s->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz,
+                                             PGSIZE)
+                                   - s->read_bytes);
                 }
               else
                 {
                   /* Entirely zero.
                      Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+                  s->read_bytes = 0;
+                  s->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz,
+                                            PGSIZE);
                 }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
             }
           else
-            goto done;
+            return false;
           break;
         }
     }
+  return true;
+}
 
-  /* Set up stack. */
-  if (!setup_stack (esp))
-    goto done;
-
-
-  /* Start with exec name */
-  curr_arg = exec_name;
-  /* Measure the length of argument and add one for a null byte */
-  curr_arg_len = strlen (curr_arg) + 1;
-  /* Push it onto the stack with current esp */
-  *esp = (char *) *esp - curr_arg_len;
-  memcpy (*esp, curr_arg, curr_arg_len);
-  /* Let the entry of argv point to the value we just pushed */
-  argv[argc] = (char *) *esp;
-  /* Increment argc */
-  argc++;
-
-  /* Repeat it with the rest of arguments */
-  while ((curr_arg = strtok_r (NULL, " ", &saveptr)) != NULL)
-  {
-    /* Measure the length of argument and add one for a null byte */
-    curr_arg_len = strlen (curr_arg) + 1;
-    /* Push it onto the stack with current esp */
-    *esp = (char *) *esp - curr_arg_len;
-    memcpy (*esp, curr_arg, curr_arg_len);
-    /* Let the entry of argv point to the value we just pushed */
-    argv[argc] = (char *) *esp;
-    /* Increment argc */
-    argc++;
-  }
-
-  /* End argv with a null pointer */
-  argv[argc] = NULL;
-
-  /* Pad esp to perform word align */
-  padding = (unsigned int)*esp % 4;
-  *esp = (char *) *esp - padding;
-
-  /* Push all the address of arguments */
-  *esp = (char *) *esp - 4*(argc+1);
-  memcpy(*esp, argv, 4*(argc+1));
-
-  /* Save current address for the next step */
-  saveptr = (char *) *esp;
+/* Forgets cache entry E.  Must hold exec_cache_lock. */
+static void
+exec_cache_drop (struct exec_cache_entry *e)
+{
+  inode_close (e->inode);
+  e->inode = NULL;
+}
 
-  /* Push the address of argv[0] */
-  *esp = (char *) *esp - 4;
-  memcpy(*esp, &saveptr, 4);
+/* Looks up the cached headers of the executable in INODE.
+   If they are present and still current, copies them into
+   *IMAGE and returns true; otherwise returns false. */
+static bool
+exec_cache_lookup (struct inode *inode, struct exec_image *image)
+{
+  block_sector_t sector = inode_get_inumber (inode);
+  bool found = false;
+  int i;
 
-  /* Push argv */
-  *esp = (char *) *esp - 4;
-  memcpy(*esp, &argc, 4);
+  lock_acquire (&exec_cache_lock);
+  for (i = 0; i < EXEC_CACHE_SIZE; i++)
+    {
+      struct exec_cache_entry *e = &exec_cache[i];
+      if (e->inode == NULL || inode_get_inumber (e->inode) != sector)
+        continue;
+      if (e->write_cnt != inode_get_write_cnt (e->inode))
+        exec_cache_drop (e);
+      else if (!inode_is_being_written (e->inode))
+        {
+          *image = e->image;
+          e->last_use = ++exec_clock;
+          found = true;
+        }
+      break;
+    }
+  lock_release (&exec_cache_lock);
+  return found;
+}
 
-  /* Push a fake return address */
-  *esp = (char *) *esp - 4;
+/* Caches IMAGE as the headers of the executable in INODE, as
+   read starting when INODE's write count was WRITE_CNT,
+   replacing the least recently used entry if the cache is full.
+   Does nothing if INODE has been written since then, is being
+   written now, or has been removed, since IMAGE may not match
+   its contents. */
+static void
+exec_cache_insert (struct inode *inode, unsigned write_cnt,
+                   const struct exec_image *image)
+{
+  block_sector_t sector = inode_get_inumber (inode);
+  struct exec_cache_entry *victim = NULL;
+  int i;
 
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
+  lock_acquire (&exec_cache_lock);
+  if (inode_get_write_cnt (inode) != write_cnt
+      || inode_is_being_written (inode) || inode_is_removed (inode))
+    {
+      lock_release (&exec_cache_lock);
+      return;
+    }
+  for (i = 0; i < EXEC_CACHE_SIZE; i++)
+    {
+      struct exec_cache_entry *e = &exec_cache[i];
+      if (e->inode != NULL && inode_get_inumber (e->inode) == sector)
+        {
+          /* Another process got here first. */
+          victim = e;
+          break;
+        }
+      if (victim == NULL
+          || (victim->inode != NULL
+              && (e->inode == NULL || e->last_use < victim->last_use)))
+        victim = e;
+    }
+  if (victim->inode != NULL)
+    exec_cache_drop (victim);
+  victim->inode = inode_reopen (inode);
+  victim->write_cnt = write_cnt;
+  victim->last_use = ++exec_clock;
+  victim->image = *image;
+  lock_release (&exec_cache_lock);
+}
 
-  success = true;
-  t->exe = file; 
-  file_deny_write (t->exe);
+/* Drops the cached headers of the executable in INODE, if any.
+   Called when INODE is removed. */
+void
+process_forget_exe (struct inode *inode)
+{
+  block_sector_t sector = inode_get_inumber (inode);
+  int i;
 
- done:
-  /* We arrive here whether the load is successful or not. */
-  // palloc_free_page (fn_copy);
-  // palloc_free_page (checking);
-  if (!file)
-    file_close (file);
-  return success;
+  lock_acquire (&exec_cache_lock);
+  for (i = 0; i < EXEC_CACHE_SIZE; i++)
+    {
+      struct exec_cache_entry *e = &exec_cache[i];
+      if (e->inode != NULL && inode_get_inumber (e->inode) == sector)
+        exec_cache_drop (e);
+    }
+  lock_release (&exec_cache_lock);
 }
-
-/* load() helpers. */
-
-static bool install_page (void *upage, void *kpage, bool writable);
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -509,34 +861,6 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
   return true;
 }
 
-bool
-check_if_valid (char *file_name)
-{
-  /* Declare variables */
-  char *curr_arg;
-  size_t numb_arg = 0;
-  char *saveptr;
-
-  /* Split input file_name by space */
-  curr_arg = strtok_r (file_name, " ", &saveptr);
-  numb_arg++;
-
-  /* Increment numb_arg until the end */
-  while ((curr_arg = strtok_r (NULL, " ", &saveptr)) != NULL)
-  {
-    numb_arg++;
-  }
-
-  /* If we have more than 32 arguments, loading fails */
-  if (numb_arg > 32)
-  {
-    printf ("Too many arguments\n");
-    return false;
-  }
-
-  return true;
-}
-
 /* Loads a segment starting at offset OFS in FILE at address
    UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual
    memory are initialized, as follows:
@@ -547,7 +871,10 @@ check_if_valid (char *file_name)
         - ZERO_BYTES bytes at UPAGE + READ_BYTES must be zeroed.
 
    The pages initialized by this function must be writable by the
-   user process if WRITABLE is true, read-only otherwise.
+   user process if WRITABLE is true, read-only otherwise.  Pages
+   with nothing to read are mapped to the shared zero frame
+   instead of being allocated and cleared here; a writable one
+   gets a frame of its own on its first write.
 
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
@@ -568,15 +895,24 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+      if (page_read_bytes == 0)
+        {
+          if (!install_zero_page (upage, writable))
+            return false;
+          zero_bytes -= page_zero_bytes;
+          upage += PGSIZE;
+          continue;
+        }
+
       /* Get a page of memory. */
-      uint8_t *kpage = palloc_get_page (PAL_USER);
+      uint8_t *kpage = frame_alloc (0);
       if (kpage == NULL)
         return false;
 
       /* Load this page. */
       if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
         {
-          palloc_free_page (kpage);
+          frame_free (kpage);
           return false;
         }
       memset (kpage + page_read_bytes, 0, page_zero_bytes);
@@ -584,7 +920,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       /* Add the page to the process's address space. */
       if (!install_page (upage, kpage, writable))
         {
-          palloc_free_page (kpage);
+          frame_free (kpage);
           return false;
         }
 
@@ -604,14 +940,14 @@ setup_stack (void **esp)
   uint8_t *kpage;
   bool success = false;
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  kpage = frame_alloc (PAL_ZERO);
   if (kpage != NULL)
     {
       success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
       if (success)
         *esp = PHYS_BASE;
       else
-        palloc_free_page (kpage);
+        frame_free (kpage);
     }
   return success;
 }
@@ -621,8 +957,7 @@ setup_stack (void **esp)
    If WRITABLE is true, the user process may modify the page;
    otherwise, it is read-only.
    UPAGE must not already be mapped.
-   KPAGE should probably be a page obtained from the user pool
-   with palloc_get_page().
+   KPAGE should be a frame obtained with frame_alloc().
    Returns true on success, false if UPAGE is already mapped or
    if memory allocation fails. */
 static bool
@@ -632,8 +967,34 @@ install_page (void *upage, void *kpage, bool writable)
 
   /* Verify that there's not already a page at that virtual
      address, then map our page there. */
-  return (pagedir_get_page (t->pagedir, upage) == NULL
-          && pagedir_set_page (t->pagedir, upage, kpage, writable));
+  if (pagedir_get_page (t->pagedir, upage) != NULL
+      || !pagedir_set_page (t->pagedir, upage, kpage, writable))
+    return false;
+  frame_set_owner (kpage, t->pagedir, upage);
+  return true;
+}
+
+/* Maps user virtual address UPAGE to the shared zero frame.
+   If WRITABLE is true, the mapping is copy-on-write, so the
+   user process may modify the page once it has faulted in a
+   private copy; otherwise, it is read-only.
+   Returns true on success, false if UPAGE is already mapped or
+   if memory allocation fails. */
+static bool
+install_zero_page (void *upage, bool writable)
+{
+  struct thread *t = thread_current ();
+  void *kpage = frame_share_zero ();
+  bool success;
+
+  success = pagedir_get_page (t->pagedir, upage) == NULL;
+  if (success)
+    success = (writable
+               ? pagedir_set_page_cow (t->pagedir, upage, kpage)
+               : pagedir_set_page (t->pagedir, upage, kpage, false));
+  if (!success)
+    frame_free (kpage);
+  return success;
 }
 
 void
@@ -641,30 +1002,27 @@ remove_children (void)
 {
   struct thread *current = thread_current ();
   struct list_elem *e, *next;
+
+  lock_acquire (&process_lock);
   e = list_begin (&current->children);
-  /* Iterates through list and downs counter, freeing when needed. */
+  /* Iterates through list, orphaning each child and freeing the
+     ones that already exited. */
   while (e != list_end (&current->children))
   {
     struct process *child_process = list_entry (e, struct process, elem);
     next = list_next (e);
     list_remove (&child_process->elem);
-    if ((--child_process->counter) == 0)
-      free (child_process);
+    child_process->parent = NULL;
+    if ((--child_process->ref_cnt) == 0)
+      free_process (child_process);
     e = next;
   }
+  lock_release (&process_lock);
 }
 
 void 
 free_fds (void)
 {
-  /* Goes through list of fd's and frees any that aren't NULL. */
-  struct thread *t = thread_current ();
-  int i;
-  for (i = 0; i < FD_LENGTH; i++) {
-    if (!t->fd_array[i])
-    {
-      file_close (t->fd_array[i]);
-      t->fd_array[i] = NULL;
-    }
-  }
+  /* Closes every open file and frees the table. */
+  fd_table_destroy (&thread_current ()->fds);
 }
@@ -1,6 +1,9 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <iovec.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -9,32 +12,85 @@
 #include "devices/input.h"
 #include "pagedir.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
 #include "process.h"
+#include "userprog/usermem.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/directory.h"
 #include "filesys/inode.h"
+#include "vm/frame.h"
 
 static void syscall_handler (struct intr_frame *);
+static bool run_syscall (uint32_t nr, const uint32_t *args, uint32_t *result);
+
+/* Number of arguments taken by each system call. */
+static const uint8_t syscall_arg_cnt[] =
+  {
+    [SYS_HALT] = 0, [SYS_EXIT] = 1, [SYS_EXEC] = 1, [SYS_WAIT] = 1,
+    [SYS_CREATE] = 2, [SYS_REMOVE] = 1, [SYS_OPEN] = 1,
+    [SYS_FILESIZE] = 1, [SYS_READ] = 3, [SYS_WRITE] = 3, [SYS_SEEK] = 2,
+    [SYS_TELL] = 1, [SYS_CLOSE] = 1, [SYS_PRACTICE] = 1,
+    [SYS_MMAP] = 2, [SYS_MUNMAP] = 1,
+    [SYS_CHDIR] = 1, [SYS_MKDIR] = 1, [SYS_READDIR] = 2, [SYS_ISDIR] = 1,
+    [SYS_INUMBER] = 1, [SYS_HIT] = 0, [SYS_MISS] = 0, [SYS_READ_CNT] = 0,
+    [SYS_WRITE_CNT] = 0, [SYS_RESET_READ_CNT] = 0,
+    [SYS_FORK] = 0, [SYS_MEMSTAT] = 1, [SYS_DUP2] = 2, [SYS_READV] = 3,
+    [SYS_WRITEV] = 3, [SYS_PREAD] = 4, [SYS_PWRITE] = 4,
+    [SYS_RING_SETUP] = 1, [SYS_RING_ENTER] = 0, [SYS_WAIT_ANY] = 1,
+  };
+
 /*
-  Checks ADDRESS to make sure it is valid (not in kernel address space.)
+  Copies the CNT arguments of the system call in F into ARGS.
+  Kills the process if they cannot be read.
 */
-void *get_kernel_address (const void *address);
+static void get_args (const struct intr_frame *f, uint32_t *args, size_t cnt);
 
 /*
-  Checks ADDRESS to make sure it is mapped, and if so returns
-  the kernel virtual address corresponding to
-  the physical memory mapped by ADDRESS.
+  Copies the string at user address USTR into a new page and
+  returns it, or returns a null pointer if no page is free, so
+  that the call can fail.  Kills the process if the string cannot
+  be read or does not fit in a page.  The caller must free the
+  page.
 */
-void check_pointer (const void *address);
+static char *get_string (uint32_t ustr);
 
 /*
   Checks BUFFER to make sure both BUFFER all the way to BUFFER + SIZE are valid.
 */
 void check_buffer (const void *buffer, unsigned size);
 
-int first_null (void);
+/*
+  Pins every page of BUFFER in memory for the duration of a
+  system call, first making each page writable if WRITE is true.
+  Kills the process if any page is unmapped (or read-only).
+*/
+void pin_buffer (const void *buffer, unsigned size, bool write);
+
+/*
+  Releases the pins taken by pin_buffer (BUFFER, SIZE, ...).
+*/
+void unpin_buffer (const void *buffer, unsigned size);
+
+/*
+  Checks that each of the CNT buffers in IOV is in user space and
+  that their total length fits in an int.  Kills the process if
+  a buffer is not in user space; returns false if the total is
+  too large.
+*/
+static bool check_iov (const struct iovec *iov, int cnt);
+
+/*
+  Pins every page of the CNT buffers in IOV, as pin_buffer().
+*/
+static void pin_iov (const struct iovec *iov, int cnt, bool write);
+
+/*
+  Releases the pins taken by pin_iov (IOV, CNT, ...).
+*/
+static void unpin_iov (const struct iovec *iov, int cnt);
+
 struct file* get_check_file (int);
 
 void
@@ -46,180 +102,242 @@ syscall_init (void)
 static void
 syscall_handler (struct intr_frame *f UNUSED)
 {
-  uint32_t* args = ((uint32_t*) f->esp);
-
-  /* checks the validity of the stack pointer to the syscall number */
-  get_kernel_address ((const void*) args);
+  uint32_t nr, args[4];
+  char *str;
 
-  void *cmd_line;
+  /* Reads the syscall number and its arguments straight off the
+     user stack. */
+  if (!copy_from_user (&nr, f->esp, sizeof nr))
+    exit (-1);
+  if (nr >= sizeof syscall_arg_cnt / sizeof *syscall_arg_cnt)
+    return;
+  get_args (f, args, syscall_arg_cnt[nr]);
 
   /* Start of Task 2. */
-  switch (args[0])
+  switch (nr)
   {
     case SYS_HALT:
     {
       halt ();
       break;
     }
-    case SYS_PRACTICE:
+    case SYS_EXEC:
     {
-      check_pointer (&args[1]);
-      f->eax = practice (args[1]);
+      str = get_string (args[0]);
+      f->eax = str != NULL ? exec (str) : -1;
+      palloc_free_page (str);
       break;
     }
-    case SYS_EXEC:
+    case SYS_WAIT:
     {
-      cmd_line = get_kernel_address ((void *) args[1]);
-      f->eax = exec ((const char *) cmd_line);
+      f->eax = wait (args[0]);
       break;
     }
-    case SYS_WAIT:
+    case SYS_WAIT_ANY:
     {
-      check_pointer (&args[1]);
-      f->eax = wait (args[1]);
+      int status;
+
+      f->eax = wait_any (&status);
+      if ((pid_t) f->eax != -1 && args[0] != 0
+          && !copy_to_user ((int *) args[0], &status, sizeof status))
+        exit (-1);
       break;
     }
     case SYS_EXIT:
     {
-      check_pointer (&args[1]);
-      f->eax = args[1];
-      exit (args[1]);
+      f->eax = args[0];
+      exit (args[0]);
+      break;
+    }
+    case SYS_FORK:
+    {
+      /* Needs the caller's whole register state, not just its
+         arguments, so it goes straight to process.c. */
+      f->eax = process_fork (f);
       break;
     }
     /* End of Task 2. */
 
-    /* Start of Task 3 */
-    void *file_name;
-    void *buf;
+    case SYS_RING_SETUP:
+    {
+      f->eax = ring_setup ((struct syscall_ring *) args[0]);
+      break;
+    }
+    case SYS_RING_ENTER:
+    {
+      f->eax = ring_enter ();
+      break;
+    }
+    default:
+    {
+      /* Everything else may also be queued on a ring. */
+      run_syscall (nr, args, &f->eax);
+      break;
+    }
+  }
+}
 
-    case SYS_CREATE:
+/* Runs system call NR, which is not one that creates, waits for
+   or ends a process, with arguments ARGS, storing its return
+   value, if any, into *RESULT.  Returns false if NR is not such
+   a system call. */
+static bool
+run_syscall (uint32_t nr, const uint32_t *args, uint32_t *result)
+{
+  char *str;
+
+  switch (nr)
+  {
+    case SYS_PRACTICE:
     {
-      file_name = get_kernel_address ((void *) args[1]);
-      check_pointer (&args[2]);
+      *result = practice (args[0]);
+      break;
+    }
 
-      f->eax = create (file_name, args[2]);
+    /* Start of Task 3 */
+    case SYS_CREATE:
+    {
+      str = get_string (args[0]);
+      *result = str != NULL ? create (str, args[1]) : false;
+      palloc_free_page (str);
       break;
     }
     case SYS_REMOVE:
     {
-      file_name = get_kernel_address ((void *) args[1]);
-
-      f->eax = remove (file_name);
+      str = get_string (args[0]);
+      *result = str != NULL ? remove (str) : false;
+      palloc_free_page (str);
       break;
     }
     case SYS_OPEN:
     {
-      file_name = get_kernel_address ((void *) args[1]);
-
-      f->eax = open (file_name);
+      str = get_string (args[0]);
+      *result = str != NULL ? open (str) : -1;
+      palloc_free_page (str);
       break;
     }
     case SYS_FILESIZE:
     {
-      check_pointer (&args[1]);
-
-      f->eax = filesize (args[1]);
+      *result = filesize (args[0]);
       break;
     }
     case SYS_READ:
     {
-      check_pointer (&args[1]);
-      check_buffer ((void *) args[2], (unsigned) args[3]);
-      buf = get_kernel_address ((void *) args[2]);
-      check_pointer (&args[3]);
+      check_buffer ((void *) args[1], (unsigned) args[2]);
 
-      f->eax = read (args[1], buf, args[3]);
+      *result = read (args[0], (void *) args[1], args[2]);
       break;
     }
     case SYS_WRITE:
     {
-      check_pointer (&args[1]);
-      check_buffer ((void *) args[2], (unsigned) args[3]);
-      buf = get_kernel_address ((void *) args[2]);
-      check_pointer (&args[3]);
+      check_buffer ((void *) args[1], (unsigned) args[2]);
 
-      f->eax = write (args[1], buf, args[3]);
+      *result = write (args[0], (const void *) args[1], args[2]);
       break;
     }
-    case SYS_SEEK:
+    case SYS_READV:
+    case SYS_WRITEV:
+    {
+      struct iovec iov[IOV_MAX];
+
+      if (args[2] > IOV_MAX)
+      {
+        *result = -1;
+        break;
+      }
+      if (!copy_from_user (iov, (const void *) args[1],
+                           args[2] * sizeof *iov))
+        exit (-1);
+
+      if (nr == SYS_READV)
+        *result = readv (args[0], iov, args[2]);
+      else
+        *result = writev (args[0], iov, args[2]);
+      break;
+    }
+    case SYS_PREAD:
     {
-      check_pointer (&args[1]);
-      check_pointer (&args[2]);
+      check_buffer ((void *) args[1], (unsigned) args[2]);
 
-      seek (args[1], args[2]);
+      *result = pread (args[0], (void *) args[1], args[2], args[3]);
       break;
     }
-    case SYS_TELL:
+    case SYS_PWRITE:
     {
-      check_pointer (&args[1]);
+      check_buffer ((void *) args[1], (unsigned) args[2]);
 
-      f->eax = tell (args[1]);
+      *result = pwrite (args[0], (const void *) args[1], args[2], args[3]);
+      break;
+    }
+    case SYS_SEEK:
+    {
+      seek (args[0], args[1]);
+      break;
+    }
+    case SYS_TELL:
+    {
+      *result = tell (args[0]);
       break;
     }
     case SYS_CLOSE:
     {
-      check_pointer (&args[1]);
-
-      close (args[1]);
+      close (args[0]);
       break;
     }
     /* End of Task 3 */
 
-    void *path;
     /* Added for project 3 */
     case SYS_CHDIR:
     {
-      path = get_kernel_address ((void *) args[1]);
-
-      f->eax = chdir ((const char *) path);
+      str = get_string (args[0]);
+      *result = str != NULL ? chdir (str) : false;
+      palloc_free_page (str);
       break;
     }
     case SYS_MKDIR:
     {
-      path = get_kernel_address ((void *) args[1]);
-
-      f->eax = mkdir ((const char *) path);
+      str = get_string (args[0]);
+      *result = str != NULL ? mkdir (str) : false;
+      palloc_free_page (str);
       break;
     }
     case SYS_READDIR:
     {
-      check_pointer (&args[1]);
-      path = get_kernel_address ((void *) args[2]);
-      f->eax = readdir (args[1], path);
+      char name[NAME_MAX + 1];
+
+      *result = readdir (args[0], name);
+      if (*result && !copy_to_user ((char *) args[1], name, strlen (name) + 1))
+        exit (-1);
       break;
     }
     case SYS_ISDIR:
     {
-      check_pointer (&args[1]);
-
-      f->eax = isdir (args[1]);
+      *result = isdir (args[0]);
       break;
     }
     case SYS_INUMBER:
     {
-      check_pointer (&args[1]);
-
-      f->eax = inumber (args[1]);
+      *result = inumber (args[0]);
       break;
     }
     case SYS_HIT:
     {
-      f->eax = hit ();
+      *result = hit ();
       break;
     }
     case SYS_MISS:
     {
-      f->eax = miss ();
+      *result = miss ();
       break;
     } 
     case SYS_READ_CNT:
     {
-      f->eax = read_cnt ();
+      *result = read_cnt ();
       break;
     }
     case SYS_WRITE_CNT:
     {
-      f->eax = write_cnt ();
+      *result = write_cnt ();
       break;
     }
     case SYS_RESET_READ_CNT:
@@ -227,7 +345,50 @@ syscall_handler (struct intr_frame *f UNUSED)
       reset_read ();
       break;
     } 
+    case SYS_DUP2:
+    {
+      *result = dup2 (args[0], args[1]);
+      break;
+    }
+    case SYS_MEMSTAT:
+    {
+      struct memstat ms;
+
+      memstat (&ms);
+      if (!copy_to_user ((struct memstat *) args[0], &ms, sizeof ms))
+        exit (-1);
+      break;
+    }
+    default:
+      return false;
   }
+  return true;
+}
+
+static void
+get_args (const struct intr_frame *f, uint32_t *args, size_t cnt)
+{
+  if (!copy_from_user (args, (const uint32_t *) f->esp + 1,
+                       cnt * sizeof *args))
+    exit (-1);
+}
+
+static char *
+get_string (uint32_t ustr)
+{
+  char *str = palloc_get_page (0);
+  int len;
+
+  if (str == NULL)
+    return NULL;
+  len = strncpy_from_user (str, (const char *) ustr, PGSIZE);
+
+  if (len < 0 || len >= PGSIZE)
+  {
+    palloc_free_page (str);
+    exit (-1);
+  }
+  return str;
 }
 
 
@@ -250,21 +411,11 @@ void
 exit (int status)
 {
   struct thread *current = thread_current ();
-  struct process *proc = current->proc;
-  if (proc)
-  {
-    /* Decrements proc's counter and frees if parent already exited. */
-    if ((--proc->counter) == 0)
-      free (proc);
-    else
-    {
-      /* Otherwise we set the exit conditions for the proc so the parent can access. */
-      proc->exit_success = true;
-      if (proc->waited_on == true)
-        sema_up (&proc->wait_child);
-      proc->exit_status = status;
-    }
-  }
+
+  /* Leave the status for our parent.  process_exit() tells it
+     we are done. */
+  if (current->proc != NULL)
+    current->proc->exit_status = status;
 
   printf ("%s: exit(%d)\n", current->name, status);
   thread_exit ();
@@ -274,31 +425,9 @@ pid_t
 exec (const char *cmd_line)
 {
   pid_t pid = process_execute (cmd_line);
-  struct thread *current = thread_current ();
-  bool found = false;
-  struct process *p = NULL;
-
-  /*  Iterate through the child processes of the current (parent) thread
-      and find the child to execute.
-  */
-  struct list_elem *e;
-  for (e = list_begin (&current->children);
-       e != list_end (&current->children) && found == false;
-       e = list_next (e))
-  {
-    struct process *temp = list_entry (e, struct process, elem);
-    if (temp->child_pid == pid)
-    {
-      p = temp;
-      found = true;
-    }
-  }
 
-  /* Wait till the child process has finally loaded. */
-  while (p->load_success == 2)
-    thread_yield ();
-  /* If child failed to load successfully. */
-  if (!p || p->load_success == 0)
+  /* Sleep until the child has finished loading. */
+  if (pid == TID_ERROR || !process_wait_load (pid))
     return -1;
 
   return pid;
@@ -310,6 +439,12 @@ wait (pid_t pid)
   return process_wait (pid);
 }
 
+pid_t
+wait_any (int *status)
+{
+  return process_wait_any (status);
+}
+
 bool
 create (const char *file, unsigned initial_size)
 {
@@ -332,12 +467,12 @@ open (const char *file)
     return -1;
   } 
   else {
-    int first = first_null ();
-    if (inode_is_dir (file_get_inode (fptr))) {
-      thread_current ()->cwd = (struct dir *) fptr;
+    int fd = fd_install (&thread_current ()->fds, fptr);
+    if (fd < 0) {
+      file_close (fptr);
+      return -1;
     }
-    thread_current ()->fd_array[first] = fptr;
-    return first;
+    return fd;
   }
 }
 
@@ -351,52 +486,219 @@ filesize (int fd)
     return -1;
 }
 
+/* Reads and writes go straight to and from the user's frames:
+   the whole buffer is pinned up front, then transferred one page
+   at a time through the kernel's mapping of each frame, since
+   consecutive user pages need not be adjacent in memory. */
 int
 read (int fd, void *buffer, unsigned size)
 {
-  if (fd == STDIN_FILENO)
-  {
-    unsigned i = 0;
-    char *ret = (char *) buffer;
-    for (; i < size; i++) {
-      ret[i] = input_getc ();
-    }
-    return size;
-  }
-  else if (fd == STDOUT_FILENO)
+  uint32_t *pd = thread_current ()->pagedir;
+  uint8_t *udst = buffer;
+  unsigned left = size;
+  struct file *f = NULL;
+  int bytes_read = 0;
+
+  if (fd == STDOUT_FILENO)
     return 0;
-  else
+  else if (fd != STDIN_FILENO)
   {
-    struct file *f = get_check_file (fd);
+    f = get_check_file (fd);
     if (!f)
       return -1;
     /* Don't read from directory, so error */
     if (inode_is_dir (file_get_inode (f)))
       return -1;
-    return file_read (f, buffer, size);
   }
+
+  pin_buffer (buffer, size, true);
+  while (left > 0)
+  {
+    uint8_t *kdst = pagedir_get_page (pd, udst);
+    unsigned chunk = PGSIZE - pg_ofs (udst);
+    unsigned chunk_read;
+    if (chunk > left)
+      chunk = left;
+
+    if (f == NULL)
+    {
+      for (chunk_read = 0; chunk_read < chunk; chunk_read++)
+        kdst[chunk_read] = input_getc ();
+    }
+    else
+      chunk_read = file_read (f, kdst, chunk);
+
+    bytes_read += chunk_read;
+    udst += chunk_read;
+    left -= chunk_read;
+    if (chunk_read < chunk)
+      break;
+  }
+  unpin_buffer (buffer, size);
+  return bytes_read;
 }
 
 int
 write (int fd, const void *buffer, unsigned size)
 {
-  if (fd == STDOUT_FILENO)
-  {
-    putbuf (buffer, size);
-    return size;
-  }
-  else if (fd == STDIN_FILENO)
+  uint32_t *pd = thread_current ()->pagedir;
+  const uint8_t *usrc = buffer;
+  unsigned left = size;
+  struct file *f = NULL;
+  int bytes_written = 0;
+
+  if (fd == STDIN_FILENO)
     return 0;
-  else
+  else if (fd != STDOUT_FILENO)
   {
-    struct file *f = get_check_file (fd);
+    f = get_check_file (fd);
     if (!f)
       return -1;
     /* Don't write to directory, so error */
     if (inode_is_dir (file_get_inode (f)))
       return -1;
-    return file_write (f, buffer, size);
   }
+
+  pin_buffer (buffer, size, false);
+  while (left > 0)
+  {
+    const uint8_t *ksrc = pagedir_get_page (pd, usrc);
+    unsigned chunk = PGSIZE - pg_ofs (usrc);
+    unsigned chunk_written;
+    if (chunk > left)
+      chunk = left;
+
+    if (f == NULL)
+    {
+      putbuf ((const char *) ksrc, chunk);
+      chunk_written = chunk;
+    }
+    else
+      chunk_written = file_write (f, ksrc, chunk);
+
+    bytes_written += chunk_written;
+    usrc += chunk_written;
+    left -= chunk_written;
+    if (chunk_written < chunk)
+      break;
+  }
+  unpin_buffer (buffer, size);
+  return bytes_written;
+}
+
+/* The vectored and positional calls below pin the user's buffers
+   and then let the file system copy straight to and from the
+   user's own addresses, which cannot fault while the pages are
+   pinned (and, for reads, made writable).  That way all of the
+   buffers of a readv() or writev() reach the inode layer as a
+   single request. */
+
+/* Reads from FD into the CNT buffers in IOV, in order. */
+int
+readv (int fd, const struct iovec *iov, int cnt)
+{
+  struct file *f = NULL;
+  int bytes_read = 0;
+  int i;
+
+  if (!check_iov (iov, cnt))
+    return -1;
+  if (fd == STDOUT_FILENO)
+    return 0;
+  else if (fd != STDIN_FILENO)
+  {
+    f = get_check_file (fd);
+    if (!f || inode_is_dir (file_get_inode (f)))
+      return -1;
+  }
+
+  pin_iov (iov, cnt, true);
+  if (f == NULL)
+  {
+    for (i = 0; i < cnt; i++)
+    {
+      uint8_t *buffer = iov[i].iov_base;
+      size_t j;
+
+      for (j = 0; j < iov[i].iov_len; j++)
+        buffer[j] = input_getc ();
+      bytes_read += iov[i].iov_len;
+    }
+  }
+  else
+    bytes_read = file_readv (f, iov, cnt);
+  unpin_iov (iov, cnt);
+  return bytes_read;
+}
+
+/* Writes the CNT buffers in IOV, in order, to FD. */
+int
+writev (int fd, const struct iovec *iov, int cnt)
+{
+  struct file *f = NULL;
+  int bytes_written = 0;
+  int i;
+
+  if (!check_iov (iov, cnt))
+    return -1;
+  if (fd == STDIN_FILENO)
+    return 0;
+  else if (fd != STDOUT_FILENO)
+  {
+    f = get_check_file (fd);
+    if (!f || inode_is_dir (file_get_inode (f)))
+      return -1;
+  }
+
+  pin_iov (iov, cnt, false);
+  if (f == NULL)
+  {
+    for (i = 0; i < cnt; i++)
+    {
+      putbuf (iov[i].iov_base, iov[i].iov_len);
+      bytes_written += iov[i].iov_len;
+    }
+  }
+  else
+    bytes_written = file_writev (f, iov, cnt);
+  unpin_iov (iov, cnt);
+  return bytes_written;
+}
+
+/* Reads SIZE bytes from FD into BUFFER, starting at OFFSET in the
+   file, without using or moving the file's position. */
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct file *f = get_check_file (fd);
+  int bytes_read;
+
+  if (!f || inode_is_dir (file_get_inode (f))
+      || (off_t) offset < 0 || (off_t) size < 0)
+    return -1;
+
+  pin_buffer (buffer, size, true);
+  bytes_read = file_read_at (f, buffer, size, offset);
+  unpin_buffer (buffer, size);
+  return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER to FD, starting at OFFSET in the
+   file, without using or moving the file's position. */
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  struct file *f = get_check_file (fd);
+  int bytes_written;
+
+  if (!f || inode_is_dir (file_get_inode (f))
+      || (off_t) offset < 0 || (off_t) size < 0)
+    return -1;
+
+  pin_buffer (buffer, size, false);
+  bytes_written = file_write_at (f, buffer, size, offset);
+  unpin_buffer (buffer, size);
+  return bytes_written;
 }
 
 void
@@ -414,53 +716,106 @@ tell (int fd)
 void
 close (int fd)
 {
-  file_close (get_check_file (fd));
-  thread_current ()->fd_array[fd] = NULL;
+  if (fd < 0 || fd >= FD_MAX)
+    exit (-1);
+  file_close (fd_remove (&thread_current ()->fds, fd));
 }
 
-void *
-get_kernel_address (const void *address)
+/* Makes NEW_FD refer to the file that OLD_FD refers to. */
+int
+dup2 (int old_fd, int new_fd)
 {
-  /* checks if ptr is null or if ptr is in kernel address space */
-  check_pointer (address);
+  return fd_dup2 (&thread_current ()->fds, old_fd, new_fd);
+}
 
-  /* validates ptr to make sure it maps to a location in physical memory */
-  int *ptr;
-  if ((ptr = pagedir_get_page (thread_current ()->pagedir, address)) == NULL)
+void
+check_buffer (const void *buffer, unsigned size)
+{
+  /* BUFFER + SIZE may wrap around to a user address, which would
+     pass a check of the end alone and pin nothing. */
+  if (!is_user_range (buffer, size)) {
     exit (-1);
-  return ptr;
+  }
 }
 
 void
-check_pointer (const void *address)
+pin_buffer (const void *buffer, unsigned size, bool write)
 {
-  if (!address || is_kernel_vaddr (address))
-    exit (-1);
+  uint32_t *pd = thread_current ()->pagedir;
+  const uint8_t *end = (const uint8_t *) buffer + size;
+  const uint8_t *upage, *pinned;
+
+  for (upage = pg_round_down (buffer); upage < end; upage += PGSIZE)
+    if (pagedir_pin_page (pd, upage, write) == NULL)
+    {
+      /* Let go of the pages pinned so far before dying. */
+      for (pinned = pg_round_down (buffer); pinned < upage; pinned += PGSIZE)
+        pagedir_unpin_page (pd, pinned);
+      exit (-1);
+    }
 }
 
 void
-check_buffer (const void *buffer, unsigned size)
+unpin_buffer (const void *buffer, unsigned size)
 {
-  if (is_kernel_vaddr (buffer) || is_kernel_vaddr (buffer + size)) {
-    exit (-1);
+  uint32_t *pd = thread_current ()->pagedir;
+  const uint8_t *end = (const uint8_t *) buffer + size;
+  const uint8_t *upage;
+
+  for (upage = pg_round_down (buffer); upage < end; upage += PGSIZE)
+    pagedir_unpin_page (pd, upage);
+}
+
+static bool
+check_iov (const struct iovec *iov, int cnt)
+{
+  size_t total = 0;
+  int i;
+
+  for (i = 0; i < cnt; i++)
+  {
+    check_buffer (iov[i].iov_base, iov[i].iov_len);
+    if (iov[i].iov_len > INT_MAX - total)
+      return false;
+    total += iov[i].iov_len;
   }
+  return true;
 }
 
-/*
- * This function returns the index of the first null element in
- * the fd_array.
-*/
-int
-first_null()
+static void
+pin_iov (const struct iovec *iov, int cnt, bool write)
 {
-  struct thread *t = thread_current ();
-  int i = 2;
-  for (; i < FD_LENGTH; i++) {
-   if (t->fd_array[i] == NULL) {
-     return i;
-   }
+  uint32_t *pd = thread_current ()->pagedir;
+  int i;
+
+  for (i = 0; i < cnt; i++)
+  {
+    const uint8_t *end = (const uint8_t *) iov[i].iov_base + iov[i].iov_len;
+    const uint8_t *upage;
+
+    for (upage = pg_round_down (iov[i].iov_base); upage < end;
+         upage += PGSIZE)
+      if (pagedir_pin_page (pd, upage, write) == NULL)
+      {
+        /* Let go of the pages pinned so far before dying. */
+        const uint8_t *pinned;
+
+        for (pinned = pg_round_down (iov[i].iov_base); pinned < upage;
+             pinned += PGSIZE)
+          pagedir_unpin_page (pd, pinned);
+        unpin_iov (iov, i);
+        exit (-1);
+      }
   }
-  return FD_LENGTH;
+}
+
+static void
+unpin_iov (const struct iovec *iov, int cnt)
+{
+  int i;
+
+  for (i = 0; i < cnt; i++)
+    unpin_buffer (iov[i].iov_base, iov[i].iov_len);
 }
 
 /*
@@ -469,13 +824,9 @@ first_null()
 struct file *
 get_check_file (int fd)
 {
-  struct thread *t = thread_current ();
-  if (fd < 0 || fd >= FD_LENGTH)
+  if (fd < 0 || fd >= FD_MAX)
     exit(-1);
-  if (t->fd_array[fd] == NULL) {
-    return NULL;
-  }
-  return t->fd_array[fd];
+  return fd_lookup (&thread_current ()->fds, fd);
 }
 
 /* Project 3-3 syscalls. */
@@ -510,7 +861,18 @@ readdir (int fd, char *filename)
   if (!inode_is_dir (file_get_inode (f))) {
     return false;
   }
-  return dir_readdir (thread_current ()->cwd, filename);
+
+  /* Read through a directory handle that starts and ends at F's
+     position. */
+  struct dir *dir = dir_open (inode_reopen (file_get_inode (f)));
+  bool ret;
+  if (dir == NULL)
+    return false;
+  dir_seek (dir, file_tell (f));
+  ret = dir_readdir (dir, filename);
+  file_seek (f, dir_tell (dir));
+  dir_close (dir);
+  return ret;
 }
 
 bool
@@ -529,13 +891,8 @@ inumber (int fd)
   int ret;
   /* TODO: Acquire lock. */
   struct file *f = get_check_file (fd);
-  if (!inode_is_dir (file_get_inode (f))) {
-    ret = (int) inode_get_inumber (file_get_inode (f));
-  }
-  else {
-    ret = (int) inode_get_inumber (dir_get_inode ((struct dir *) f));
+  ret = (int) inode_get_inumber (file_get_inode (f));
   /* TODO: Release lock. */
-  }
   return ret;
 }
 
@@ -568,3 +925,80 @@ reset_read (void)
 {
   return filesys_reset_read_cnt ();
 }
+
+/* Registers RING, in the running process's memory, as its
+   system call ring, replacing any ring registered before.  A
+   null RING unregisters the ring.  Returns false if RING is not
+   in user memory. */
+bool
+ring_setup (struct syscall_ring *ring)
+{
+  struct syscall_ring probe;
+
+  if (ring != NULL && !copy_from_user (&probe, ring, sizeof probe))
+    return false;
+  thread_current ()->ring = ring;
+  return true;
+}
+
+/* Runs, in order, the system calls queued on the running
+   process's ring, as many as there are free completion slots
+   for, and posts a completion for each.  The ring's counters are
+   read once at the start and written back once at the end.
+   Returns the number of calls run, or -1 if no ring is
+   registered.  Kills the process if the ring cannot be read or
+   written. */
+int
+ring_enter (void)
+{
+  struct syscall_ring *ring = thread_current ()->ring;
+  uint32_t sq_head, sq_tail, cq_head, cq_tail;
+  int cnt = 0;
+
+  if (ring == NULL)
+    return -1;
+  if (!copy_from_user (&sq_head, &ring->sq_head, sizeof sq_head)
+      || !copy_from_user (&sq_tail, &ring->sq_tail, sizeof sq_tail)
+      || !copy_from_user (&cq_head, &ring->cq_head, sizeof cq_head)
+      || !copy_from_user (&cq_tail, &ring->cq_tail, sizeof cq_tail))
+    exit (-1);
+
+  while (sq_head != sq_tail && cq_tail - cq_head < RING_ENTRIES)
+  {
+    struct ring_sqe sqe;
+    struct ring_cqe cqe;
+    uint32_t result = 0;
+
+    if (!copy_from_user (&sqe, &ring->sq[sq_head % RING_ENTRIES],
+                         sizeof sqe))
+      exit (-1);
+    if (!run_syscall (sqe.nr, sqe.args, &result))
+      result = -1;
+
+    cqe.user_data = sqe.user_data;
+    cqe.result = result;
+    if (!copy_to_user (&ring->cq[cq_tail % RING_ENTRIES], &cqe, sizeof cqe))
+      exit (-1);
+    sq_head++;
+    cq_tail++;
+    cnt++;
+  }
+
+  if (!copy_to_user (&ring->sq_head, &sq_head, sizeof sq_head)
+      || !copy_to_user (&ring->cq_tail, &cq_tail, sizeof cq_tail))
+    exit (-1);
+  return cnt;
+}
+
+/* Reports the calling process's memory usage into MS. */
+void
+memstat (struct memstat *ms)
+{
+  struct thread *t = thread_current ();
+
+  ms->rss = pagedir_count_present (t->pagedir);
+  ms->wss = frame_working_set (t);
+  ms->page_faults = t->fault_cnt;
+  ms->pages_in = t->page_in_cnt;
+  ms->pages_out = t->page_out_cnt;
+}
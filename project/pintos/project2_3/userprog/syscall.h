@@ -1,6 +1,9 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 #include <stdio.h>
+#include <iovec.h>
+#include <memstat.h>
+#include <syscall-ring.h>
 
 typedef int pid_t;
 
@@ -12,6 +15,7 @@ void halt (void);
 void exit (int);
 pid_t exec (const char *);
 int wait (pid_t);
+pid_t wait_any (int *);
 
 /* File operation syscalls */
 bool create (const char *, unsigned);
@@ -23,6 +27,11 @@ int write (int, const void *, unsigned);
 void seek (int, unsigned);
 unsigned tell (int);
 void close (int);
+int readv (int, const struct iovec *, int);
+int writev (int, const struct iovec *, int);
+int pread (int, void *, unsigned, unsigned);
+int pwrite (int, const void *, unsigned, unsigned);
+int dup2 (int, int);
 
 /* File Systems, Project 3 Task 3. */
 bool chdir (const char *filename);
@@ -36,4 +45,11 @@ unsigned long long read_cnt (void);
 unsigned long long write_cnt (void);
 void reset_read (void);
 
+/* Batched system calls. */
+bool ring_setup (struct syscall_ring *);
+int ring_enter (void);
+
+/* Virtual memory. */
+void memstat (struct memstat *);
+
 #endif /* userprog/syscall.h */
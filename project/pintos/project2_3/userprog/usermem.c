@@ -0,0 +1,126 @@
+#include "userprog/usermem.h"
+#include <debug.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Access to user memory from the kernel.
+
+   System calls read their arguments from, and write their
+   results to, user memory directly through the user's own
+   mappings, instead of looking up each page in the page
+   directory first.  Only the two instructions below ever touch
+   user memory.  If one of them takes a page fault that
+   page_fault() cannot resolve, because the address is unmapped
+   or the page is read-only, page_fault() calls usermem_fixup(),
+   which resumes execution just past the instruction as if it
+   had stopped early.  Pages that are in swap or shared
+   copy-on-write are brought in by page_fault() as usual, so a
+   buffer may span any number of pages in any state.
+
+   The instructions must appear only once in the kernel, so the
+   functions that contain them must not be inlined. */
+
+/* Addresses of the instructions that touch user memory, and of
+   the instructions that follow them. */
+void usermem_copy_insn (void), usermem_copy_done (void);
+void usermem_get_insn (void), usermem_get_done (void);
+
+/* Copies SIZE bytes from SRC to DST, either of which may be in
+   user memory.  Returns the number of bytes not copied because
+   of a page fault, 0 if successful. */
+static size_t __attribute__ ((noinline))
+copy_bytes (void *dst, const void *src, size_t size)
+{
+  asm volatile (".globl usermem_copy_insn\n"
+                "usermem_copy_insn:\n\t"
+                "rep movsb\n"
+                ".globl usermem_copy_done\n"
+                "usermem_copy_done:"
+                : "+D" (dst), "+S" (src), "+c" (size)
+                : : "memory");
+  return size;
+}
+
+/* Returns the byte at user address UADDR, or -1 if it cannot be
+   read. */
+static int __attribute__ ((noinline))
+get_byte (const uint8_t *uaddr)
+{
+  int result;
+  asm volatile ("movl $-1, %0\n"
+                ".globl usermem_get_insn\n"
+                "usermem_get_insn:\n\t"
+                "movzbl (%1), %0\n"
+                ".globl usermem_get_done\n"
+                "usermem_get_done:"
+                : "=&r" (result) : "r" (uaddr));
+  return result;
+}
+
+/* Returns true if the SIZE bytes starting at UADDR all lie in
+   user address space, without wrapping around. */
+bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns true
+   if successful, false if some byte could not be read. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  return is_user_range (usrc, size) && copy_bytes (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns true
+   if successful, false if some byte could not be written.  Bytes
+   before the first one that could not be written may have been
+   written. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  return is_user_range (udst, size) && copy_bytes (udst, src, size) == 0;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes, including the null
+   terminator.  Returns the length of the string, not including
+   the null terminator; SIZE if the string does not fit; or -1 if
+   some byte of it could not be read. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  const uint8_t *usrc_ = (const uint8_t *) usrc;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    {
+      int c;
+
+      if (!is_user_vaddr (usrc_ + i) || (c = get_byte (usrc_ + i)) < 0)
+        return -1;
+      dst[i] = c;
+      if (c == '\0')
+        return i;
+    }
+  return size;
+}
+
+/* Called by page_fault() for a fault in kernel code that it
+   could not resolve.  If F's instruction is one of ours that
+   touches user memory, makes F resume after it and returns true.
+   Otherwise, returns false. */
+bool
+usermem_fixup (struct intr_frame *f)
+{
+  if (f->eip == usermem_copy_insn)
+    f->eip = usermem_copy_done;
+  else if (f->eip == usermem_get_insn)
+    f->eip = usermem_get_done;
+  else
+    return false;
+  return true;
+}
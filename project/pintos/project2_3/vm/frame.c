@@ -0,0 +1,573 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/swap.h"
+
+/* Frame table.
+
+   There is one entry for every physical page of RAM, indexed
+   by physical page number, so that looking up the entry for a
+   kernel virtual address is a single subtraction.  Only entries
+   for frames handed out by frame_alloc() are ever used.
+
+   A frame may be mapped by more than one page table at a time
+   after a fork(): the child starts out sharing every page of
+   its parent, copy-on-write.  SHARE_CNT counts those mappings,
+   and the frame is only returned to the user pool once the
+   last of them is gone.
+
+   Pages that start out all zeros are mapped to a single shared
+   zero frame in the same way, so untouched BSS costs neither a
+   frame nor a memset.  The frame table holds a reference of its
+   own to the zero frame, which therefore always looks shared
+   and is never freed.
+
+   A system call that reads or writes a user buffer pins every
+   frame of the buffer for the duration of the I/O, so that the
+   frame stays put while the kernel accesses it through its own
+   mapping, possibly with file system locks held.
+
+   A frame mapped by exactly one page table whose owner is known
+   (see frame_set_owner()) sits on FRAME_LIST and may be evicted
+   to swap.  The evictor runs the clock algorithm over the list,
+   giving recently accessed frames a second chance, and writes
+   up to SWAP_CLUSTER victims to adjacent swap slots in a single
+   transfer.  frame_lock is not held during the write: victims
+   are pinned instead, and a victim is only unmapped afterward
+   if it is still unpinned, unshared, and clean, that is, if its
+   owner did not touch it while it was being written.
+
+   To keep page faults from waiting on those writes, a page-out
+   thread keeps a small reserve of free frames, refilling it in
+   the background whenever it runs low.  frame_alloc() falls
+   back to the reserve once the user pool is exhausted, and only
+   evicts synchronously when the reserve is empty too.
+
+   Each process's working set is estimated by sampling accessed
+   bits as the clock hand sweeps: the frames of a process found
+   accessed during one full lap of the hand make up its working
+   set for the next lap.  On its first lap around, the evictor
+   only takes frames from processes that own more frames than
+   their working set, so that one process touching more memory
+   than fits cannot push everyone else's active pages out. */
+struct frame
+  {
+    int share_cnt;              /* # of page tables mapping frame. */
+    int pin_cnt;                /* # of outstanding pins. */
+    struct thread *owner;       /* Owning process, if known. */
+    uint32_t *pd;               /* OWNER's page directory. */
+    void *upage;                /* User page mapped in PD. */
+    struct list_elem elem;      /* Element in frame_list. */
+  };
+
+static struct frame *frames;    /* Frame table, one per RAM page. */
+static struct lock frame_lock;  /* Protects the frame table. */
+static void *zero_frame;        /* Shared all-zero frame. */
+
+/* Evictable frames, in clock order. */
+static struct list frame_list;
+static struct list_elem *clock_hand;
+static unsigned clock_lap = 1;  /* # of laps of CLOCK_HAND, from 1. */
+
+/* Free frames held back for frame_alloc() by the page-out
+   thread, which refills the reserve to RESERVE_HIGH frames
+   once fewer than RESERVE_LOW remain. */
+#define RESERVE_LOW (SWAP_CLUSTER / 2)
+#define RESERVE_HIGH (SWAP_CLUSTER * 2)
+static void *reserve[RESERVE_HIGH];
+static size_t reserve_cnt;
+static struct semaphore pageout_sema;   /* Wakes page-out thread. */
+static bool pageout_started;
+
+static struct frame *frame_lookup (void *kpage);
+static void *frame_kpage (struct frame *);
+static void frame_link (struct frame *, uint32_t *pd, void *upage);
+static void frame_unlink (struct frame *);
+static void *reserve_take (void);
+static void reserve_put (void *kpage);
+static void ws_sample (struct thread *);
+static size_t evict (void *kpages[], size_t max);
+static thread_func pageout_thread NO_RETURN;
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  size_t pages = DIV_ROUND_UP (init_ram_pages * sizeof *frames, PGSIZE);
+
+  lock_init (&frame_lock);
+  lock_set_name (&frame_lock, "frame");
+  list_init (&frame_list);
+  sema_init (&pageout_sema, 0);
+  frames = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, pages);
+  zero_frame = frame_alloc (PAL_ASSERT | PAL_ZERO);
+}
+
+/* Starts the page-out thread.  Must be called after
+   swap_init(), and only matters if there is swap to page out
+   to. */
+void
+frame_start (void)
+{
+  if (!swap_available ())
+    return;
+  pageout_started = true;
+  thread_create ("pageout", PRI_DEFAULT, pageout_thread, NULL);
+}
+
+/* Obtains a frame and returns its kernel virtual address, with
+   FLAGS as for palloc_get_page().  Once the user pool runs dry,
+   frames come from the page-out thread's reserve, and failing
+   that from evicting other frames to swap.  The frame starts
+   out mapped by a single page table, with no owner.  Returns a
+   null pointer if no frames are available. */
+void *
+frame_alloc (enum palloc_flags flags)
+{
+  void *kpage = palloc_get_page (PAL_USER | (flags & ~PAL_ASSERT));
+
+  if (kpage == NULL)
+    {
+      kpage = reserve_take ();
+      if (kpage == NULL && swap_available ())
+        {
+          void *kpages[SWAP_CLUSTER];
+          size_t cnt = evict (kpages, SWAP_CLUSTER);
+
+          if (cnt > 0)
+            {
+              kpage = kpages[0];
+              while (cnt-- > 1)
+                reserve_put (kpages[cnt]);
+            }
+        }
+      if (kpage != NULL && (flags & PAL_ZERO))
+        memset (kpage, 0, PGSIZE);
+    }
+  if (kpage == NULL)
+    {
+      if (flags & PAL_ASSERT)
+        PANIC ("frame_alloc: out of frames");
+      return NULL;
+    }
+
+  lock_acquire (&frame_lock);
+  frame_lookup (kpage)->share_cnt = 1;
+  lock_release (&frame_lock);
+  return kpage;
+}
+
+/* Records that KPAGE, mapped by a single page table, is mapped
+   there by PD, the current process's page directory, at user
+   page UPAGE, which makes it a candidate for eviction.  Must be
+   called once the mapping is in PD. */
+void
+frame_set_owner (void *kpage, uint32_t *pd, void *upage)
+{
+  struct frame *f;
+
+  ASSERT (thread_current ()->pagedir == pd);
+
+  lock_acquire (&frame_lock);
+  f = frame_lookup (kpage);
+  if (f->share_cnt == 1 && f->pd == NULL)
+    frame_link (f, pd, upage);
+  lock_release (&frame_lock);
+}
+
+/* Withdraws every frame owned by PD from eviction, including
+   any that are being evicted right now.  Called before PD is
+   destroyed. */
+void
+frame_forget_pagedir (uint32_t *pd)
+{
+  struct list_elem *e, *next;
+
+  lock_acquire (&frame_lock);
+  for (e = list_begin (&frame_list); e != list_end (&frame_list); e = next)
+    {
+      struct frame *f = list_entry (e, struct frame, elem);
+      next = list_next (e);
+      if (f->pd == pd)
+        frame_unlink (f);
+    }
+  lock_release (&frame_lock);
+}
+
+/* Records that KPAGE is now mapped by one more page table. */
+void
+frame_share (void *kpage)
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  f = frame_lookup (kpage);
+  f->share_cnt++;
+  if (f->pd != NULL)
+    frame_unlink (f);
+  lock_release (&frame_lock);
+}
+
+/* Returns the shared zero frame, counting one more page table
+   mapping it.  It must only ever be mapped read-only. */
+void *
+frame_share_zero (void)
+{
+  frame_share (zero_frame);
+  return zero_frame;
+}
+
+/* Returns true if KPAGE is the shared zero frame. */
+bool
+frame_is_zero (const void *kpage)
+{
+  return kpage == zero_frame;
+}
+
+/* Returns true if KPAGE is mapped by more than one page table. */
+bool
+frame_is_shared (void *kpage)
+{
+  bool shared;
+
+  lock_acquire (&frame_lock);
+  shared = frame_lookup (kpage)->share_cnt > 1;
+  lock_release (&frame_lock);
+  return shared;
+}
+
+/* Pins the frame that user virtual address UADDR in PD maps
+   to and returns the kernel virtual address corresponding to
+   UADDR, or returns a null pointer if UADDR is not present. */
+void *
+frame_pin_page (uint32_t *pd, const void *uaddr)
+{
+  void *kaddr;
+
+  /* The evictor only unmaps frames with frame_lock held, so a
+     frame found present here stays put once pinned. */
+  lock_acquire (&frame_lock);
+  kaddr = pagedir_get_page (pd, uaddr);
+  if (kaddr != NULL)
+    frame_lookup (pg_round_down (kaddr))->pin_cnt++;
+  lock_release (&frame_lock);
+  return kaddr;
+}
+
+/* Releases one pin on KPAGE, returning it to the user pool if
+   its last mapping went away while it was pinned. */
+void
+frame_unpin (void *kpage)
+{
+  struct frame *f;
+  bool last;
+
+  lock_acquire (&frame_lock);
+  f = frame_lookup (kpage);
+  ASSERT (f->pin_cnt > 0);
+  last = --f->pin_cnt == 0 && f->share_cnt == 0;
+  lock_release (&frame_lock);
+
+  if (last)
+    palloc_free_page (kpage);
+}
+
+/* Drops one mapping of KPAGE, returning it to the user pool
+   once no page table maps it any longer and it is not pinned. */
+void
+frame_free (void *kpage)
+{
+  struct frame *f;
+  bool last;
+
+  lock_acquire (&frame_lock);
+  f = frame_lookup (kpage);
+  ASSERT (f->share_cnt > 0);
+  if (--f->share_cnt == 0 && f->pd != NULL)
+    frame_unlink (f);
+  last = f->share_cnt == 0 && f->pin_cnt == 0;
+  lock_release (&frame_lock);
+
+  if (last)
+    palloc_free_page (kpage);
+}
+
+/* Returns the frame table entry for KPAGE. */
+static struct frame *
+frame_lookup (void *kpage)
+{
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (vtop (kpage) >> PGBITS < init_ram_pages);
+
+  return &frames[vtop (kpage) >> PGBITS];
+}
+
+/* Returns the current estimate of T's working set, in frames.
+   Until the clock hand has been all the way around once, every
+   frame T owns counts as part of it. */
+int
+frame_working_set (struct thread *t)
+{
+  int wss;
+
+  lock_acquire (&frame_lock);
+  ws_sample (t);
+  wss = t->wss;
+  lock_release (&frame_lock);
+  return wss;
+}
+
+/* Returns the kernel virtual address of the frame F describes. */
+static void *
+frame_kpage (struct frame *f)
+{
+  return ptov ((uintptr_t) (f - frames) << PGBITS);
+}
+
+/* Makes F, owned by PD at UPAGE, evictable.  F is inserted just
+   behind the clock hand, so it is the last to be considered. */
+static void
+frame_link (struct frame *f, uint32_t *pd, void *upage)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  f->owner = thread_current ();
+  f->pd = pd;
+  f->upage = upage;
+  if (++f->owner->frame_cnt > f->owner->peak_frame_cnt)
+    f->owner->peak_frame_cnt = f->owner->frame_cnt;
+  if (clock_hand != NULL)
+    list_insert (clock_hand, &f->elem);
+  else
+    list_push_back (&frame_list, &f->elem);
+}
+
+/* Withdraws F from eviction and forgets its owner. */
+static void
+frame_unlink (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  if (clock_hand == &f->elem)
+    clock_hand = list_next (clock_hand);
+  if (clock_hand == list_end (&frame_list))
+    clock_hand = NULL;
+  list_remove (&f->elem);
+  f->owner->frame_cnt--;
+  f->owner = NULL;
+  f->pd = NULL;
+  f->upage = NULL;
+}
+
+/* Takes a frame from the reserve, waking the page-out thread if
+   the reserve is running low.  Returns a null pointer if the
+   reserve is empty. */
+static void *
+reserve_take (void)
+{
+  void *kpage = NULL;
+
+  lock_acquire (&frame_lock);
+  if (reserve_cnt > 0)
+    kpage = reserve[--reserve_cnt];
+  if (reserve_cnt < RESERVE_LOW && pageout_started)
+    sema_up (&pageout_sema);
+  lock_release (&frame_lock);
+  return kpage;
+}
+
+/* Adds free frame KPAGE to the reserve, or returns it to the
+   user pool if the reserve is full. */
+static void
+reserve_put (void *kpage)
+{
+  lock_acquire (&frame_lock);
+  if (reserve_cnt < RESERVE_HIGH)
+    {
+      reserve[reserve_cnt++] = kpage;
+      kpage = NULL;
+    }
+  lock_release (&frame_lock);
+
+  if (kpage != NULL)
+    palloc_free_page (kpage);
+}
+
+/* Evicts up to MAX frames, at most SWAP_CLUSTER, to swap,
+   writing them in as few clustered writes as the free slots
+   allow.  Stores the kernel virtual addresses
+   of the frames it freed into KPAGES[] and returns how many
+   there are, which may be 0 if every frame is pinned or in
+   active use or if swap is full. */
+static size_t
+evict (void *kpages[], size_t max)
+{
+  struct frame *victims[SWAP_CLUSTER];
+  void *victim_pages[SWAP_CLUSTER];
+  size_t victim_cnt = 0;
+  size_t freed_cnt = 0;
+  size_t lap_len, scan_cnt, i;
+  swap_slot_t slots[SWAP_CLUSTER];
+
+  ASSERT (max <= SWAP_CLUSTER);
+
+  /* Choose victims with the clock algorithm.  The first lap
+     spares the frames of processes within their working sets;
+     two more are enough to clear every accessed bit once. */
+  lock_acquire (&frame_lock);
+  lap_len = list_size (&frame_list);
+  for (scan_cnt = 0; victim_cnt < max && scan_cnt < 3 * lap_len; scan_cnt++)
+    {
+      struct frame *f;
+      enum intr_level old_level;
+
+      if (clock_hand == NULL)
+        clock_hand = list_begin (&frame_list);
+      f = list_entry (clock_hand, struct frame, elem);
+      clock_hand = list_next (clock_hand);
+      if (clock_hand == list_end (&frame_list))
+        {
+          clock_hand = NULL;
+          clock_lap++;
+        }
+
+      if (f->pin_cnt > 0)
+        continue;
+
+      ws_sample (f->owner);
+      if (pagedir_test_and_clear_accessed (f->pd, f->upage))
+        {
+          f->owner->ws_refs++;
+          continue;
+        }
+      if (scan_cnt < lap_len && f->owner->frame_cnt <= f->owner->wss)
+        continue;
+
+      /* Writes from here on make the owner's PTE dirty again,
+         which cancels the eviction below.  The owner may be
+         preempted with its page table in hand, so clear the
+         dirty bit atomically. */
+      old_level = intr_disable ();
+      pagedir_set_dirty (f->pd, f->upage, false);
+      intr_set_level (old_level);
+      f->pin_cnt++;
+      victim_pages[victim_cnt] = frame_kpage (f);
+      victims[victim_cnt++] = f;
+    }
+  lock_release (&frame_lock);
+
+  if (victim_cnt == 0)
+    return 0;
+
+  /* Write the victims in runs of adjacent slots.  When swap is
+     too fragmented for the whole cluster, use shorter runs, down
+     to single slots.  Victims that get no slot stay resident. */
+  for (i = 0; i < victim_cnt; )
+    {
+      size_t run = victim_cnt - i;
+      swap_slot_t slot;
+      size_t j;
+
+      while ((slot = swap_alloc (run)) == SWAP_ERROR && run > 1)
+        run /= 2;
+      if (slot == SWAP_ERROR)
+        break;
+      swap_write (slot, victim_pages + i, run);
+      for (j = 0; j < run; j++)
+        slots[i++] = slot + j;
+    }
+  for (; i < victim_cnt; i++)
+    slots[i] = SWAP_ERROR;
+
+  /* Unmap the victims that nobody touched during the write. */
+  lock_acquire (&frame_lock);
+  for (i = 0; i < victim_cnt; i++)
+    {
+      struct frame *f = victims[i];
+      bool evicted = false;
+
+      if (slots[i] != SWAP_ERROR && f->pd != NULL
+          && f->pin_cnt == 1 && f->share_cnt == 1)
+        {
+          enum intr_level old_level = intr_disable ();
+          evicted = pagedir_swap_out (f->pd, f->upage, victim_pages[i],
+                                      slots[i]);
+          intr_set_level (old_level);
+          if (evicted)
+            f->owner->page_out_cnt++;
+        }
+      if (slots[i] != SWAP_ERROR && !evicted)
+        swap_free (slots[i]);
+
+      f->pin_cnt--;
+      if (evicted)
+        {
+          frame_unlink (f);
+          f->share_cnt = 0;
+        }
+      if (f->share_cnt == 0 && f->pin_cnt == 0)
+        kpages[freed_cnt++] = victim_pages[i];
+    }
+  lock_release (&frame_lock);
+
+  return freed_cnt;
+}
+
+/* Brings T's working-set sample up to date with the clock hand.
+   Once the hand has gone all the way around since T's sample
+   began, the frames T had used during that lap become its
+   working-set estimate and a new sample begins. */
+static void
+ws_sample (struct thread *t)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  if (t->ws_lap == clock_lap)
+    return;
+
+  /* A process whose last sample did not cover exactly the
+     previous lap, such as a new one, gets the benefit of the
+     doubt. */
+  if (t->ws_lap != 0 && t->ws_lap + 1 == clock_lap)
+    t->wss = t->ws_refs;
+  else
+    t->wss = t->frame_cnt;
+  t->ws_refs = 0;
+  t->ws_lap = clock_lap;
+}
+
+/* Page-out thread.  Refills the frame reserve, a cluster at a
+   time, whenever frame_alloc() finds it running low. */
+static void
+pageout_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      sema_down (&pageout_sema);
+      for (;;)
+        {
+          void *kpages[SWAP_CLUSTER];
+          size_t want, cnt;
+
+          lock_acquire (&frame_lock);
+          want = RESERVE_HIGH - reserve_cnt;
+          lock_release (&frame_lock);
+          if (want == 0)
+            break;
+
+          cnt = evict (kpages, want < SWAP_CLUSTER ? want : SWAP_CLUSTER);
+          if (cnt == 0)
+            break;
+          while (cnt-- > 0)
+            reserve_put (kpages[cnt]);
+        }
+    }
+}
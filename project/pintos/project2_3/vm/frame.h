@@ -0,0 +1,23 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/palloc.h"
+#include "threads/thread.h"
+
+void frame_init (void);
+void frame_start (void);
+void *frame_alloc (enum palloc_flags);
+void frame_set_owner (void *kpage, uint32_t *pd, void *upage);
+void frame_forget_pagedir (uint32_t *pd);
+void frame_share (void *kpage);
+void *frame_share_zero (void);
+bool frame_is_zero (const void *kpage);
+bool frame_is_shared (void *kpage);
+void *frame_pin_page (uint32_t *pd, const void *uaddr);
+void frame_unpin (void *kpage);
+void frame_free (void *kpage);
+int frame_working_set (struct thread *);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,130 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap space.
+
+   The swap device is divided into page-sized slots, tracked in
+   a bitmap.  Pages are paged out in clusters: the evictor asks
+   for a run of adjacent slots and writes all of its victims with
+   a single multi-sector transfer, instead of one request per
+   sector of each page.  Pages are read back in one at a time, a
+   page's worth of sectors per request, as they are faulted on. */
+
+/* Sectors per page-sized swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block *swap_device;       /* Swap device, if any. */
+static struct bitmap *used_slots;       /* Slots in use. */
+static struct lock swap_lock;           /* Protects USED_SLOTS, stats. */
+
+/* Statistics. */
+static long long page_out_cnt;          /* # of pages written out. */
+static long long cluster_cnt;           /* # of clustered writes. */
+static long long page_in_cnt;           /* # of pages read back in. */
+
+/* Initializes swap space on the block device in the swap role,
+   if there is one.  Without a swap device, swap_alloc() always
+   fails and so nothing is ever paged out. */
+void
+swap_init (void)
+{
+  lock_init (&swap_lock);
+  lock_set_name (&swap_lock, "swap");
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    return;
+
+  used_slots = bitmap_create (block_size (swap_device) / SECTORS_PER_SLOT);
+  if (used_slots == NULL)
+    PANIC ("swap: bitmap creation failed");
+}
+
+/* Returns true if there is a swap device to page out to. */
+bool
+swap_available (void)
+{
+  return used_slots != NULL;
+}
+
+/* Allocates CNT adjacent free slots and returns the first one,
+   or SWAP_ERROR if swap is full or there is no swap device. */
+swap_slot_t
+swap_alloc (size_t cnt)
+{
+  size_t slot;
+
+  if (used_slots == NULL)
+    return SWAP_ERROR;
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (used_slots, 0, cnt, false);
+  lock_release (&swap_lock);
+
+  return slot != BITMAP_ERROR ? slot : SWAP_ERROR;
+}
+
+/* Releases SLOT for reuse. */
+void
+swap_free (swap_slot_t slot)
+{
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (used_slots, slot));
+  bitmap_reset (used_slots, slot);
+  lock_release (&swap_lock);
+}
+
+/* Writes the CNT pages in KPAGES[] to the adjacent slots
+   starting at SLOT, which must have been allocated together by
+   swap_alloc(), as one clustered transfer. */
+void
+swap_write (swap_slot_t slot, void *const kpages[], size_t cnt)
+{
+  const void *sectors[SWAP_CLUSTER * SECTORS_PER_SLOT];
+  size_t i;
+
+  ASSERT (cnt <= SWAP_CLUSTER);
+
+  for (i = 0; i < cnt * SECTORS_PER_SLOT; i++)
+    sectors[i] = (const uint8_t *) kpages[i / SECTORS_PER_SLOT]
+                 + i % SECTORS_PER_SLOT * BLOCK_SECTOR_SIZE;
+  block_write_multiple (swap_device, slot * SECTORS_PER_SLOT,
+                        sectors, cnt * SECTORS_PER_SLOT);
+
+  lock_acquire (&swap_lock);
+  page_out_cnt += cnt;
+  cluster_cnt++;
+  lock_release (&swap_lock);
+}
+
+/* Reads the page in SLOT into KPAGE.  The slot stays allocated;
+   release it with swap_free(). */
+void
+swap_read (swap_slot_t slot, void *kpage)
+{
+  void *sectors[SECTORS_PER_SLOT];
+  size_t i;
+
+  for (i = 0; i < SECTORS_PER_SLOT; i++)
+    sectors[i] = (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE;
+  block_read_multiple (swap_device, slot * SECTORS_PER_SLOT,
+                       sectors, SECTORS_PER_SLOT);
+
+  lock_acquire (&swap_lock);
+  page_in_cnt++;
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  if (swap_device != NULL)
+    printf ("Swap: %lld pages out in %lld clusters, %lld pages in\n",
+            page_out_cnt, cluster_cnt, page_in_cnt);
+}
@@ -0,0 +1,22 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Index of a page-sized slot in the swap device. */
+typedef size_t swap_slot_t;
+#define SWAP_ERROR SIZE_MAX
+
+/* Most pages written to swap in one clustered transfer. */
+#define SWAP_CLUSTER 8
+
+void swap_init (void);
+bool swap_available (void);
+swap_slot_t swap_alloc (size_t cnt);
+void swap_free (swap_slot_t);
+void swap_write (swap_slot_t, void *const kpages[], size_t cnt);
+void swap_read (swap_slot_t, void *kpage);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */